@@ -0,0 +1,109 @@
+// Synthetic workload used to train PGO builds (see PIX2ASCII_PGO in CMakeLists.txt).
+// Renders generated frames through every draw_row variant into a curses screen
+// that writes to /dev/null, so no terminal, camera or ffmpeg is needed.
+
+#include <limits.h>
+#include <ncurses.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame_processing.h"
+#include "termstream.h"
+#include "status_codes.h"
+
+#define WORKLOAD_WIDTH 1280
+#define WORKLOAD_HEIGHT 720
+#define WORKLOAD_N_FRAMES 60
+#define WORKLOAD_EDGE_THRESHOLD 48  // the -edge-threshold default
+#define WORKLOAD_TERM "xterm-256color"
+
+// static gradient background with a moving box: most cells repeat, some change every frame
+static void fill_frame(unsigned char *frame, int width, int height, int frame_index) {
+    int box_size = height / 4;
+    int box_row = (frame_index * 7) % (height - box_size);
+    int box_col = (frame_index * 13) % (width - box_size);
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            unsigned char *pixel = frame + (i * width + j) * 3;
+            int in_box = i >= box_row && i < box_row + box_size && j >= box_col && j < box_col + box_size;
+            pixel[0] = in_box ? 255 : (unsigned char) (j * 255 / width);
+            pixel[1] = in_box ? (unsigned char) (frame_index * 4) : (unsigned char) (i * 255 / height);
+            pixel[2] = (unsigned char) ((i + j) / 8);
+        }
+    }
+}
+
+int main() {
+    FILE *null_output = fopen("/dev/null", "w");
+    if (!null_output) {
+        fprintf(stderr, "Couldn't open /dev/null!");
+        return FOPEN_ERROR;
+    }
+    SCREEN *screen = newterm(WORKLOAD_TERM, null_output, stdin);
+    if (!screen) {
+        fprintf(stderr, "Couldn't create " WORKLOAD_TERM " screen!");
+        return TERMINAL_COLORS_ERROR;
+    }
+    start_color();
+    set_color_pairs();
+
+    frame_params_t frame_data;
+    frame_data.width = WORKLOAD_WIDTH;
+    frame_data.height = WORKLOAD_HEIGHT;
+    frame_data.aspect_ratio = frame_data.width / frame_data.height;
+    frame_data.triple_width = frame_data.width * 3;
+    frame_data.video_frame = malloc(sizeof(unsigned char) * frame_data.triple_width * frame_data.height);
+    if (!frame_data.video_frame) {
+        fprintf(stderr, "Couldn't allocate memory for frame!");
+        return FRAME_ALLOCATION_ERROR;
+    }
+
+    terminal_params_t terminal_params;
+    terminal_params.color_flag = 0;
+    terminal_params.preserve_aspect_flag = 0;
+    terminal_params.max_width = INT_MAX;
+    terminal_params.max_height = INT_MAX;
+    terminal_params.grid_scale = 100;
+
+    charset_params_t charset_params = {"$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. ", 69};
+    kernel_update_method filters[] = {update_naive, update_gaussian, update_area};
+    region_intensity_t methods[] = {average_chanel_intensity, yuv_intensity};
+
+    int return_status = SUCCESS;
+    int combination = 0;
+    for (int edge_flag = 0; edge_flag < 2; ++edge_flag) {
+        for (int filter_ind = 0; filter_ind < 3; ++filter_ind) {
+            for (int method_ind = 0; method_ind < 2; ++method_ind) {
+                for (int output = 0; output < OUTPUT_N; ++output, ++combination) {
+                    kernel_params_t kernel_data;
+                    kernel_data.kernel = NULL;
+                    kernel_data.update_kernel = filters[filter_ind];
+                    cell_cache_t cell_cache;
+                    init_cell_cache(&cell_cache);
+                    draw_row_method_t draw_row = get_draw_row_method(filters[filter_ind], methods[method_ind],
+                                                                     (output_t) output, edge_flag);
+
+                    // a new size per combination forces update_terminal_size to rebuild the kernel
+                    resizeterm(40 + combination * 3, 120 + combination * 10);
+                    for (int frame_index = 0; frame_index < WORKLOAD_N_FRAMES && !return_status; ++frame_index) {
+                        fill_frame(frame_data.video_frame, frame_data.width, frame_data.height, frame_index);
+                        if (!(return_status = update_terminal_size(&frame_data, &kernel_data, &terminal_params)))
+                            return_status = draw_frame(&frame_data, &kernel_data, charset_params,
+                                                       WORKLOAD_EDGE_THRESHOLD, terminal_params.left_border_indent,
+                                                       draw_row, &cell_cache);
+                        refresh();
+                    }
+                    free_cell_cache(&cell_cache);
+                    free(kernel_data.kernel);
+                }
+            }
+        }
+    }
+
+    endwin();
+    delscreen(screen);
+    fclose(null_output);
+    free(frame_data.video_frame);
+    free_resample_cache();
+    return return_status;
+}
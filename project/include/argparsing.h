@@ -3,7 +3,7 @@
 
 #include "frame_processing.h"
 
-typedef enum {SOURCE_FILE, SOURCE_CAMERA} source_t;
+typedef enum {SOURCE_FILE, SOURCE_CAMERA, SOURCE_MAPPED} source_t;
 
 typedef struct {
     char *char_set;
@@ -16,18 +16,30 @@ typedef struct {
     int left_border_indent;
     int max_width;
     int max_height;
+    char *capture_path;  // headless mode: frames go to this file instead of the terminal
+    int grid_scale;  // percent of the terminal covered by the grid; lowered by the quality controller
+    int adaptive_quality_flag;
 } terminal_params_t;
 
 typedef struct {
     source_t reading_type;
     char *file_path;
     int n_stream_loops;
+    int raw_width;      // frame size of raw rgb24 files, which have no header
+    int raw_height;
+    double start_time;  // seconds; exact for decoded and mapped files
     char *player_flag;
+    char *camera_format;    // ffmpeg input format and input of the camera source
+    char *camera_input;
+    int low_latency_flag;   // camera: newest frame as soon as it arrives instead of a steady 25 fps
 } ffmpeg_params_t;
 
 typedef struct {
     region_intensity_t rgb_channels_processor;
     kernel_update_method update_kernel;
+    int streaming_flag;  // convert band by band while the frame is still arriving
+    int edge_flag;       // directional glyphs where the footprint holds an edge
+    int edge_threshold;  // gradient magnitude (1-255) above which edge glyphs are drawn
 } frame_processing_params_t;
 
 typedef struct {
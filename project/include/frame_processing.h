@@ -1,6 +1,11 @@
 #ifndef PROJECT_INCLUDE_FRAME_UTILS_H_
 #define PROJECT_INCLUDE_FRAME_UTILS_H_
 
+#include <stdint.h>
+#include <string.h>
+
+#include "resample.h"
+
 typedef struct {
     unsigned char *video_frame;
     int width;
@@ -17,24 +22,380 @@ int update_naive(double **kernel, int width, int height);
 
 int update_gaussian(double **kernel, int width, int height);
 
+// area resampling: the weights live in the resample tables, so there is no 2D kernel
+int update_area(double **kernel, int width, int height);
+
 typedef struct {
     double *kernel;
     int width;
     int height;
     int volume;  // cached for region_intensity_t: width * height * 3
     kernel_update_method update_kernel;
+    const resample_axis_t *row_axis;  // area filter only, NULL otherwise;
+    const resample_axis_t *col_axis;  // width and height are the longest footprints then
 } kernel_params_t;
 
+// first pixel row of a character row's footprint
+static inline int get_footprint_row(const kernel_params_t *kernel_params, int cur_char_row) {
+    return kernel_params->row_axis
+            ? kernel_params->row_axis->starts[cur_char_row]
+            : cur_char_row * kernel_params->width;
+}
+
 void convolve(const frame_params_t *frame_params,
               const kernel_params_t *kernel_params,
               int cur_pixel_row,
               int cur_pixel_col,
               double *r, double *g, double *b);
 
+// cheap fingerprint of the pixels covered by one kernel footprint;
+// used to detect regions that didn't change since the previous frame
+uint64_t tile_hash(const frame_params_t *frame_params,
+                   const kernel_params_t *kernel_params,
+                   int cur_pixel_row,
+                   int cur_pixel_col);
+
 typedef unsigned char (*region_intensity_t)(double r, double g, double b);
 
 unsigned char average_chanel_intensity(double r, double g, double b);
 
 unsigned char yuv_intensity(double r, double g, double b);
 
+// =============================================
+// Inline versions of the per-cell steps above. The specialized draw kernels in termstream.c
+// are built from these so the whole per-cell pipeline can be inlined and vectorized;
+// the out-of-line functions above are thin wrappers around them.
+
+#define TILE_HASH_SEED 0xcbf29ce484222325ULL
+#define TILE_HASH_PRIME 0x100000001b3ULL
+
+static inline uint64_t region_hash_inline(const frame_params_t *frame_params,
+                                          int cur_pixel_row,
+                                          int cur_pixel_col,
+                                          int n_pixel_rows,
+                                          int n_pixel_cols) {
+    uint64_t hash = TILE_HASH_SEED;
+    uint64_t word;
+
+    int down_row = cur_pixel_row + n_pixel_rows;
+    int row_span = n_pixel_cols * 3;  // bytes of one footprint row
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cur_pixel_col * 3;
+    for (int i = cur_pixel_row; i < down_row; ++i, row_start += frame_params->triple_width) {
+        int byte_ind = 0;
+        // 8 bytes at a time: FNV-style mixing of whole words
+        for (; byte_ind + (int) sizeof(word) <= row_span; byte_ind += sizeof(word)) {
+            memcpy(&word, row_start + byte_ind, sizeof(word));
+            hash = (hash ^ word) * TILE_HASH_PRIME;
+        }
+        for (; byte_ind < row_span; ++byte_ind)
+            hash = (hash ^ row_start[byte_ind]) * TILE_HASH_PRIME;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static inline uint64_t tile_hash_inline(const frame_params_t *frame_params,
+                                        const kernel_params_t *kernel_params,
+                                        int cur_pixel_row,
+                                        int cur_pixel_col) {
+    return region_hash_inline(frame_params, cur_pixel_row, cur_pixel_col,
+                              kernel_params->width, kernel_params->height);
+}
+
+// arbitrary kernel weights (gauss)
+static inline void convolve_weighted(const frame_params_t *frame_params,
+                                     const kernel_params_t *kernel_params,
+                                     int cur_pixel_row,
+                                     int cur_pixel_col,
+                                     double *r, double *g, double *b) {
+    double local_r = 0, local_g = 0, local_b = 0;
+    const double *weight = kernel_params->kernel;
+    int row_span = kernel_params->height * 3;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cur_pixel_col * 3;
+    for (int i = 0; i < kernel_params->width; ++i, row_start += frame_params->triple_width) {
+        for (int col_offset = 0; col_offset < row_span; col_offset += 3, ++weight) {
+            local_r += *weight * row_start[col_offset];
+            local_g += *weight * row_start[col_offset + 1];
+            local_b += *weight * row_start[col_offset + 2];
+        }
+    }
+    *r = local_r;
+    *g = local_g;
+    *b = local_b;
+}
+
+// every weight equals 1 / area (naive): integer sums, a single scaling at the end
+static inline void convolve_uniform(const frame_params_t *frame_params,
+                                    const kernel_params_t *kernel_params,
+                                    int cur_pixel_row,
+                                    int cur_pixel_col,
+                                    double *r, double *g, double *b) {
+    unsigned int sum_r = 0, sum_g = 0, sum_b = 0;
+    int row_span = kernel_params->height * 3;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cur_pixel_col * 3;
+    for (int i = 0; i < kernel_params->width; ++i, row_start += frame_params->triple_width) {
+        for (int col_offset = 0; col_offset < row_span; col_offset += 3) {
+            sum_r += row_start[col_offset];
+            sum_g += row_start[col_offset + 1];
+            sum_b += row_start[col_offset + 2];
+        }
+    }
+    double area = kernel_params->width * kernel_params->height;
+    *r = sum_r / area;
+    *g = sum_g / area;
+    *b = sum_b / area;
+}
+
+// Gradient variants of the two convolutions. Every footprint row is walked in three segments
+// (left half, middle column of odd widths, right half), each still a plain vectorizable sum;
+// the half sums are snapshots of the running row sums, so the gradient costs a few adds per row.
+// The gradient never looks outside the footprint, so cells stay independent of their neighbours
+// (cached cells and bands remain valid).
+
+// mean r + g + b of the right half minus the left half (x) and of the bottom half minus
+// the top half (y), in 0-255 units
+static inline void footprint_gradient(const kernel_params_t *kernel_params,
+                                      unsigned int sum_left, unsigned int sum_right,
+                                      unsigned int sum_top, unsigned int sum_bottom,
+                                      double *gradient_x, double *gradient_y) {
+    int half_cols = kernel_params->height / 2, half_rows = kernel_params->width / 2;
+    *gradient_x = half_cols
+            ? ((double) sum_right - sum_left) / (half_cols * kernel_params->width * 3)
+            : 0;
+    *gradient_y = half_rows
+            ? ((double) sum_bottom - sum_top) / (half_rows * kernel_params->height * 3)
+            : 0;
+}
+
+static inline void convolve_uniform_gradient(const frame_params_t *frame_params,
+                                             const kernel_params_t *kernel_params,
+                                             int cur_pixel_row,
+                                             int cur_pixel_col,
+                                             double *r, double *g, double *b,
+                                             double *gradient_x, double *gradient_y) {
+    unsigned int sum_r = 0, sum_g = 0, sum_b = 0;
+    unsigned int sum_left = 0, sum_right = 0, sum_top = 0, sum_bottom = 0;
+    int row_span = kernel_params->height * 3;
+    int left_end = kernel_params->height / 2 * 3;
+    int right_start = row_span - left_end;
+    int top_end = kernel_params->width / 2;
+    int bottom_start = kernel_params->width - top_end;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cur_pixel_col * 3;
+    for (int i = 0; i < kernel_params->width; ++i, row_start += frame_params->triple_width) {
+        unsigned int row_r = 0, row_g = 0, row_b = 0;
+        int col_offset = 0;
+        for (; col_offset < left_end; col_offset += 3) {
+            row_r += row_start[col_offset];
+            row_g += row_start[col_offset + 1];
+            row_b += row_start[col_offset + 2];
+        }
+        unsigned int row_left = row_r + row_g + row_b;
+        for (; col_offset < right_start; col_offset += 3) {
+            row_r += row_start[col_offset];
+            row_g += row_start[col_offset + 1];
+            row_b += row_start[col_offset + 2];
+        }
+        unsigned int row_not_right = row_r + row_g + row_b;
+        for (; col_offset < row_span; col_offset += 3) {
+            row_r += row_start[col_offset];
+            row_g += row_start[col_offset + 1];
+            row_b += row_start[col_offset + 2];
+        }
+        unsigned int row_total = row_r + row_g + row_b;
+        sum_left += row_left;
+        sum_right += row_total - row_not_right;
+        if (i < top_end)
+            sum_top += row_total;
+        else if (i >= bottom_start)
+            sum_bottom += row_total;
+        sum_r += row_r;
+        sum_g += row_g;
+        sum_b += row_b;
+    }
+    double area = kernel_params->width * kernel_params->height;
+    *r = sum_r / area;
+    *g = sum_g / area;
+    *b = sum_b / area;
+    footprint_gradient(kernel_params, sum_left, sum_right, sum_top, sum_bottom, gradient_x, gradient_y);
+}
+
+// the gradient is unweighted: kernel weights only shape the color
+static inline void convolve_weighted_gradient(const frame_params_t *frame_params,
+                                              const kernel_params_t *kernel_params,
+                                              int cur_pixel_row,
+                                              int cur_pixel_col,
+                                              double *r, double *g, double *b,
+                                              double *gradient_x, double *gradient_y) {
+    double local_r = 0, local_g = 0, local_b = 0;
+    unsigned int sum_left = 0, sum_right = 0, sum_top = 0, sum_bottom = 0;
+    const double *weight = kernel_params->kernel;
+    int row_span = kernel_params->height * 3;
+    int left_end = kernel_params->height / 2 * 3;
+    int right_start = row_span - left_end;
+    int top_end = kernel_params->width / 2;
+    int bottom_start = kernel_params->width - top_end;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cur_pixel_col * 3;
+    for (int i = 0; i < kernel_params->width; ++i, row_start += frame_params->triple_width) {
+        unsigned int row_sum = 0;
+        int col_offset = 0;
+        for (; col_offset < left_end; col_offset += 3, ++weight) {
+            local_r += *weight * row_start[col_offset];
+            local_g += *weight * row_start[col_offset + 1];
+            local_b += *weight * row_start[col_offset + 2];
+            row_sum += row_start[col_offset] + row_start[col_offset + 1] + row_start[col_offset + 2];
+        }
+        unsigned int row_left = row_sum;
+        for (; col_offset < right_start; col_offset += 3, ++weight) {
+            local_r += *weight * row_start[col_offset];
+            local_g += *weight * row_start[col_offset + 1];
+            local_b += *weight * row_start[col_offset + 2];
+            row_sum += row_start[col_offset] + row_start[col_offset + 1] + row_start[col_offset + 2];
+        }
+        unsigned int row_not_right = row_sum;
+        for (; col_offset < row_span; col_offset += 3, ++weight) {
+            local_r += *weight * row_start[col_offset];
+            local_g += *weight * row_start[col_offset + 1];
+            local_b += *weight * row_start[col_offset + 2];
+            row_sum += row_start[col_offset] + row_start[col_offset + 1] + row_start[col_offset + 2];
+        }
+        sum_left += row_left;
+        sum_right += row_sum - row_not_right;
+        if (i < top_end)
+            sum_top += row_sum;
+        else if (i >= bottom_start)
+            sum_bottom += row_sum;
+    }
+    *r = local_r;
+    *g = local_g;
+    *b = local_b;
+    footprint_gradient(kernel_params, sum_left, sum_right, sum_top, sum_bottom, gradient_x, gradient_y);
+}
+
+// Area resampling (-filter area): every cell averages exactly its share of the frame, border pixels
+// weighted by the covered fraction. The weights are separable, so a footprint row is one fixed-point
+// dot product with the column weights, scaled once by the row weight. The footprint is addressed by
+// grid position: cur_pixel_row is its first pixel row (relative to video_frame, like everywhere),
+// cur_char_row and cur_char_col pick the table entries.
+static inline void convolve_area(const frame_params_t *frame_params,
+                                 const kernel_params_t *kernel_params,
+                                 int cur_pixel_row,
+                                 int cur_char_row,
+                                 int cur_char_col,
+                                 double *r, double *g, double *b) {
+    const resample_axis_t *rows = kernel_params->row_axis, *cols = kernel_params->col_axis;
+    const uint16_t *row_weights = rows->weights + rows->offsets[cur_char_row];
+    const uint16_t *col_weights = cols->weights + cols->offsets[cur_char_col];
+    int n_rows = rows->lengths[cur_char_row], n_cols = cols->lengths[cur_char_col];
+    uint64_t sum_r = 0, sum_g = 0, sum_b = 0;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cols->starts[cur_char_col] * 3;
+    for (int i = 0; i < n_rows; ++i, row_start += frame_params->triple_width) {
+        uint32_t row_r = 0, row_g = 0, row_b = 0;
+        for (int j = 0; j < n_cols; ++j) {
+            row_r += col_weights[j] * row_start[j * 3];
+            row_g += col_weights[j] * row_start[j * 3 + 1];
+            row_b += col_weights[j] * row_start[j * 3 + 2];
+        }
+        sum_r += (uint64_t) row_weights[i] * row_r;
+        sum_g += (uint64_t) row_weights[i] * row_g;
+        sum_b += (uint64_t) row_weights[i] * row_b;
+    }
+    double area = (double) rows->weight_sums[cur_char_row] * cols->weight_sums[cur_char_col];
+    *r = sum_r / area;
+    *g = sum_g / area;
+    *b = sum_b / area;
+}
+
+// same halves as the other gradients; as the border pixels of the halves are weighted,
+// every half is averaged by its own weight
+static inline void convolve_area_gradient(const frame_params_t *frame_params,
+                                          const kernel_params_t *kernel_params,
+                                          int cur_pixel_row,
+                                          int cur_char_row,
+                                          int cur_char_col,
+                                          double *r, double *g, double *b,
+                                          double *gradient_x, double *gradient_y) {
+    const resample_axis_t *rows = kernel_params->row_axis, *cols = kernel_params->col_axis;
+    const uint16_t *row_weights = rows->weights + rows->offsets[cur_char_row];
+    const uint16_t *col_weights = cols->weights + cols->offsets[cur_char_col];
+    int n_rows = rows->lengths[cur_char_row], n_cols = cols->lengths[cur_char_col];
+    int left_end = n_cols / 2, right_start = n_cols - left_end;
+    int top_end = n_rows / 2, bottom_start = n_rows - top_end;
+    uint64_t sum_r = 0, sum_g = 0, sum_b = 0;
+    uint64_t sum_left = 0, sum_right = 0, sum_top = 0, sum_bottom = 0;
+
+    const unsigned char *row_start = frame_params->video_frame +
+            frame_params->triple_width * cur_pixel_row + cols->starts[cur_char_col] * 3;
+    for (int i = 0; i < n_rows; ++i, row_start += frame_params->triple_width) {
+        uint32_t row_r = 0, row_g = 0, row_b = 0;
+        int j = 0;
+        for (; j < left_end; ++j) {
+            row_r += col_weights[j] * row_start[j * 3];
+            row_g += col_weights[j] * row_start[j * 3 + 1];
+            row_b += col_weights[j] * row_start[j * 3 + 2];
+        }
+        uint32_t row_left = row_r + row_g + row_b;
+        for (; j < right_start; ++j) {
+            row_r += col_weights[j] * row_start[j * 3];
+            row_g += col_weights[j] * row_start[j * 3 + 1];
+            row_b += col_weights[j] * row_start[j * 3 + 2];
+        }
+        uint32_t row_not_right = row_r + row_g + row_b;
+        for (; j < n_cols; ++j) {
+            row_r += col_weights[j] * row_start[j * 3];
+            row_g += col_weights[j] * row_start[j * 3 + 1];
+            row_b += col_weights[j] * row_start[j * 3 + 2];
+        }
+        uint32_t row_total = row_r + row_g + row_b;
+        sum_left += (uint64_t) row_weights[i] * row_left;
+        sum_right += (uint64_t) row_weights[i] * (row_total - row_not_right);
+        if (i < top_end)
+            sum_top += (uint64_t) row_weights[i] * row_total;
+        else if (i >= bottom_start)
+            sum_bottom += (uint64_t) row_weights[i] * row_total;
+        sum_r += (uint64_t) row_weights[i] * row_r;
+        sum_g += (uint64_t) row_weights[i] * row_g;
+        sum_b += (uint64_t) row_weights[i] * row_b;
+    }
+    uint32_t row_weight_sum = rows->weight_sums[cur_char_row], col_weight_sum = cols->weight_sums[cur_char_col];
+    double area = (double) row_weight_sum * col_weight_sum;
+    *r = sum_r / area;
+    *g = sum_g / area;
+    *b = sum_b / area;
+
+    uint32_t left_weight = 0, right_weight = 0, top_weight = 0, bottom_weight = 0;
+    for (int j = 0; j < left_end; ++j) {
+        left_weight += col_weights[j];
+        right_weight += col_weights[n_cols - 1 - j];
+    }
+    for (int i = 0; i < top_end; ++i) {
+        top_weight += row_weights[i];
+        bottom_weight += row_weights[n_rows - 1 - i];
+    }
+    *gradient_x = left_end
+            ? ((double) sum_right / right_weight - (double) sum_left / left_weight) / (row_weight_sum * 3.0)
+            : 0;
+    *gradient_y = top_end
+            ? ((double) sum_bottom / bottom_weight - (double) sum_top / top_weight) / (col_weight_sum * 3.0)
+            : 0;
+}
+
+static inline unsigned char average_chanel_intensity_inline(double r, double g, double b) {
+    return (unsigned char) ((r + g + b) / 3);
+}
+
+static inline unsigned char yuv_intensity_inline(double r, double g, double b) {
+    return (unsigned char) (r * 0.299 + 0.587 * g + 0.114 * b);
+}
+
 #endif  // PROJECT_INCLUDE_FRAME_UTILS_H_
@@ -0,0 +1,27 @@
+#ifndef PIX2ASCII_KEYFRAMES_H
+#define PIX2ASCII_KEYFRAMES_H
+
+#include <stddef.h>
+
+#define KEYFRAME_INDEX_EXTENSION ".keyframes"
+
+// keyframe timestamps of a file's video stream, used to restart the decoder on a keyframe
+typedef struct {
+    double *times;       // seconds, ascending
+    size_t n_keyframes;
+    double duration;     // seconds, end of the last video packet
+} keyframe_index_t;
+
+void init_keyframe_index(keyframe_index_t *index);
+
+// reads <file_path>.keyframes when it is newer than the file and was written for a file
+// of the same size, otherwise asks ffprobe
+// (demuxing only, no decoding) and tries to leave the cache next to the file
+int load_keyframe_index(keyframe_index_t *index, const char *file_path);
+
+// latest keyframe at or before time; time itself when the index is empty
+double find_keyframe(const keyframe_index_t *index, double time);
+
+void free_keyframe_index(keyframe_index_t *index);
+
+#endif //PIX2ASCII_KEYFRAMES_H
@@ -0,0 +1,45 @@
+#ifndef PIX2ASCII_MMAPSTREAM_H
+#define PIX2ASCII_MMAPSTREAM_H
+
+#include <stddef.h>
+
+typedef enum {MAPPED_RGB24, MAPPED_Y4M_420, MAPPED_Y4M_444, MAPPED_Y4M_MONO} mapped_format_t;
+
+// a preprocessed video file mapped into memory: frames are addressed, not decoded
+typedef struct {
+    unsigned char *mapping;
+    size_t mapping_size;
+    mapped_format_t format;
+    int width;
+    int height;
+    size_t first_frame_offset;  // bytes before the first frame's pixels
+    size_t frame_header_size;   // y4m "FRAME" line in front of every frame's pixels
+    size_t frame_stride;        // bytes from one frame's pixels to the next one's
+    size_t n_frames;
+    double frame_rate;          // of the file; output frames are picked at VIDEO_FRAMERATE
+    unsigned char *rgb_frame;   // conversion slot for y4m (YUV) frames
+    int n_stream_loops;         // -1 - infinite
+    size_t position;            // next output frame, loops included
+    size_t readahead_end;       // first source frame not yet advised
+} mapped_stream_t;
+
+// .rgb/.rgb24/.raw (raw rgb24, size must be given) and .y4m files are played through mmap
+int is_mapped_source(const char *file_path);
+
+void init_mapped_stream(mapped_stream_t *stream);
+
+// width and height are only used for raw rgb24 files, y4m carries its own
+int open_mapped_stream(mapped_stream_t *stream, const char *file_path,
+                       int width, int height, int n_stream_loops);
+
+void seek_mapped_stream(mapped_stream_t *stream, double seconds);
+
+// RGB24 pixels of the next output frame: a pointer into the mapping for raw files,
+// the conversion slot for y4m; NULL once every loop has been played
+unsigned char *next_mapped_frame(mapped_stream_t *stream);
+
+void skip_mapped_frames(mapped_stream_t *stream, size_t n_frames);
+
+void close_mapped_stream(mapped_stream_t *stream);
+
+#endif //PIX2ASCII_MMAPSTREAM_H
@@ -0,0 +1,60 @@
+#ifndef PIX2ASCII_PIPESTREAM_H
+#define PIX2ASCII_PIPESTREAM_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+typedef struct {
+    FILE *pipeline;        // popen handle, only kept for pclose
+    int fd;
+    int pipe_size;         // kernel pipe buffer size after F_SETPIPE_SZ
+    size_t n_reads;        // read() calls issued
+    size_t n_short_reads;  // read() calls that returned less than requested
+    int eof;
+} pipe_stream_t;
+
+// a stream with no pipeline behind it, safe to close
+void init_pipe_stream(pipe_stream_t *stream);
+
+// takes over the descriptor of a popen'ed pipeline; stdio is never used to read from it.
+// The pipe is sized for read_size: a whole frame, or a single band when streaming
+int open_pipe_stream(pipe_stream_t *stream, FILE *pipeline, size_t read_size);
+
+// resizes the pipe once the reads grow, e.g. with the band of a larger kernel
+void resize_pipe_stream(pipe_stream_t *stream, size_t read_size);
+
+// blocks until n_bytes arrived or the stream ended; returns the number of bytes read
+size_t read_pipe_stream(pipe_stream_t *stream, unsigned char *buffer, size_t n_bytes);
+
+// bytes currently waiting in the pipe, -1 if unknown
+int get_pipe_occupancy(const pipe_stream_t *stream);
+
+void close_pipe_stream(pipe_stream_t *stream);
+
+// page aligned buffer for frames/bands, release with free()
+unsigned char *alloc_frame_slot(size_t size);
+
+// One-deep "latest frame wins" handoff for live sources: everything that arrived is drained,
+// and a completed frame replaces the one waiting to be drawn. The pipe itself is the only queue,
+// so a drawn frame is at most one conversion old.
+typedef struct {
+    unsigned char *slots[2];  // ready frame, frame being received
+    size_t frame_size;
+    size_t fill;              // bytes of the frame being received
+    int has_frame;            // the ready slot holds a frame not taken yet
+    size_t n_frames;          // complete frames received
+    size_t n_dropped;         // complete frames replaced before they were taken
+    size_t frame_number;      // of the frame taken last, counted from 0
+} latest_frame_t;
+
+void init_latest_frame(latest_frame_t *latest);
+
+int open_latest_frame(latest_frame_t *latest, size_t frame_size);
+
+// sleeps until a new frame is complete, then drains whatever else already arrived;
+// returns the newest frame, NULL once the stream is over
+unsigned char *take_latest_frame(latest_frame_t *latest, pipe_stream_t *stream);
+
+void close_latest_frame(latest_frame_t *latest);
+
+#endif //PIX2ASCII_PIPESTREAM_H
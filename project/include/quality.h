@@ -0,0 +1,39 @@
+#ifndef PIX2ASCII_QUALITY_H
+#define PIX2ASCII_QUALITY_H
+
+#include <stddef.h>
+
+#include "frame_processing.h"
+#include "termstream.h"
+
+#define QUALITY_MAX_STEPS 5
+
+// one rung of the quality ladder; step 0 is what the user asked for
+typedef struct {
+    kernel_update_method update_kernel;
+    output_t output;
+    int grid_scale;  // percent of the terminal covered by the grid
+} quality_step_t;
+
+typedef struct {
+    quality_step_t steps[QUALITY_MAX_STEPS];
+    int n_steps;
+    int level;                // index of the current step
+    size_t frame_budget_us;
+    double avg_frame_time_us; // exponential moving average
+    int n_over_budget;        // consecutive frames above the degrade threshold
+    int n_under_budget;       // consecutive frames below the upgrade threshold
+} quality_controller_t;
+
+// builds the ladder: gauss -> naive, color -> mono, then coarser grids
+void init_quality_controller(quality_controller_t *controller,
+                             kernel_update_method update_kernel,
+                             output_t output,
+                             size_t frame_budget_us);
+
+// feeds the time spent on the last frame; returns 1 when the level changed
+int update_quality(quality_controller_t *controller, size_t frame_time_us);
+
+const quality_step_t *get_quality_step(const quality_controller_t *controller);
+
+#endif //PIX2ASCII_QUALITY_H
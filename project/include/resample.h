@@ -0,0 +1,28 @@
+#ifndef PIX2ASCII_RESAMPLE_H
+#define PIX2ASCII_RESAMPLE_H
+
+#include <stdint.h>
+
+#define AREA_WEIGHT_ONE 256  // fixed-point weight of a source pixel a cell covers completely
+
+// one axis of the area resampler: grid_length cells spread evenly over source_length pixels,
+// so a cell may cover a fractional number of pixels. Cell i reads source pixels
+// [starts[i], starts[i] + lengths[i]); the pixels on its borders count with the covered fraction.
+typedef struct {
+    int source_length;
+    int grid_length;
+    int max_length;          // longest footprint of the axis
+    int *starts;
+    int *lengths;
+    int *offsets;            // index of the cell's first weight in weights
+    uint16_t *weights;       // per touched pixel, AREA_WEIGHT_ONE when fully covered
+    uint32_t *weight_sums;   // per cell
+} resample_axis_t;
+
+// table for the given sizes; built on first use and kept, so resizing back and forth
+// doesn't rebuild it. NULL if it couldn't be allocated
+const resample_axis_t *get_resample_axis(int source_length, int grid_length);
+
+void free_resample_cache();
+
+#endif //PIX2ASCII_RESAMPLE_H
@@ -12,7 +12,9 @@ typedef enum {
     POPEN_ERROR,
     FRAME_ALLOCATION_ERROR,
     TERMINAL_COLORS_ERROR,
-    KERNEL_UPDATE_ERROR
+    KERNEL_UPDATE_ERROR,
+    CACHE_ALLOCATION_ERROR,
+    MAPPING_ERROR
 } return_code_t;
 
 #endif //PIX2ASCII_ERROR_H
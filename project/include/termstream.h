@@ -1,20 +1,71 @@
 #ifndef PIX2ASCII_TERMSTREAM_H
 #define PIX2ASCII_TERMSTREAM_H
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "frame_processing.h"
 #include "argparsing.h"
 
+#define CAPTURE_LATENCY_UNKNOWN SIZE_MAX  // no frame shown so far has a logged capture time
+
 typedef struct {
     size_t uS_elapsed;
     size_t frame_index;
     size_t time_frame_index;
     size_t frame_desync;
     size_t cur_frame_processing_time;
+    size_t n_reused_cells;
+    int quality_level;
+    int pipe_occupancy;
+    size_t n_short_reads;
+    size_t seek_latency_us;
+    size_t capture_latency_us;
 } sync_info_t;
 
+typedef struct {
+    uint64_t hash;  // tile_hash of the footprint this cell was computed from
+    char symbol;
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char valid;
+} cell_t;
+
+// results of the previous frame, reused for cells whose footprint didn't change
+typedef struct {
+    cell_t *cells;
+    int n_rows;
+    int n_cols;
+    int kernel_width;   // footprint the cells were computed with
+    int kernel_height;
+    size_t n_reused;    // cells reused during the last draw_frame call
+} cell_cache_t;
+
+void init_cell_cache(cell_cache_t *cell_cache);
+
+// drops every cached cell, e.g. after the filter changed but the footprint didn't
+void invalidate_cell_cache(cell_cache_t *cell_cache);
+
+void free_cell_cache(cell_cache_t *cell_cache);
+
+// resizes the cache to the current character grid and resets per-frame counters;
+// must be called once before the rows of a new frame are drawn
+int fit_cell_cache(cell_cache_t *cell_cache,
+                   const frame_params_t *frame_params,
+                   const kernel_params_t *kernel_params);
+
+// recomputes kernel and trimmed frame sizes for a grid of n_rows x n_cols characters
+int update_grid_size(frame_params_t *frame_params,
+                     kernel_params_t *kernel_params,
+                     terminal_params_t *terminal_params,
+                     int n_rows,
+                     int n_cols);
+
+// makes the next update_terminal_size call recompute the grid even if the terminal wasn't resized
+void force_terminal_update();
+
 int update_terminal_size(frame_params_t *frame_params,
                          kernel_params_t *kernel_params,
                          terminal_params_t *terminal_params);
@@ -27,12 +78,37 @@ void simple_display(const char *symbol, unsigned char r, unsigned char g, unsign
 
 void colored_display(const char *symbol, unsigned char r, unsigned char g, unsigned char b);
 
-void draw_frame(const frame_params_t *frame_params,
-                const kernel_params_t *kernel_params,
-                charset_params_t charset_params,
-                int left_border_indent,
-                region_intensity_t get_region_intensity,
-                display_method_t display_symbol);
+// draws a single character row; cur_pixel_row is relative to frame_params->video_frame,
+// so a band holding only this row's pixels can be passed with cur_pixel_row = 0
+typedef void (*draw_row_method_t)(const frame_params_t *frame_params,
+                                  const kernel_params_t *kernel_params,
+                                  charset_params_t charset_params,
+                                  int edge_threshold,
+                                  int left_border_indent,
+                                  cell_cache_t *cell_cache,
+                                  int cur_char_row,
+                                  int cur_pixel_row);
+
+typedef enum {OUTPUT_SIMPLE, OUTPUT_COLORED, OUTPUT_HEADLESS, OUTPUT_N} output_t;
+
+// picks the draw_row variant specialized for the given filter, grayscale method, output
+// and edge glyph mode; meant to be called once after argparse()
+draw_row_method_t get_draw_row_method(kernel_update_method update_kernel,
+                                      region_intensity_t get_region_intensity,
+                                      output_t output,
+                                      int edge_flag);
+
+// headless sink: writes the frame held by the cell cache as plain text,
+// one line per character row followed by an empty line
+void write_frame_text(const cell_cache_t *cell_cache, FILE *output);
+
+int draw_frame(const frame_params_t *frame_params,
+               const kernel_params_t *kernel_params,
+               charset_params_t charset_params,
+               int edge_threshold,
+               int left_border_indent,
+               draw_row_method_t draw_row,
+               cell_cache_t *cell_cache);
 
 void debug(const sync_info_t *debug_info, FILE *logs, display_method_t display_method);
 
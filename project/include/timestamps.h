@@ -10,5 +10,19 @@ typedef struct timespec timespec;
 
 timespec diff(timespec *start, timespec *end);
 uint64_t get_elapsed_time_from_start_us(timespec startTime);
+// for a startTime taken with CLOCK_MONOTONIC instead of the coarse clock
+uint64_t get_precise_elapsed_time_us(timespec startTime);
+
+// sums up intervals of actual work, e.g. the conversion of a frame without the waits for its data;
+// uses the precise clock, as single intervals may be far shorter than a coarse clock tick
+typedef struct {
+    timespec start;
+    uint64_t total_us;
+} work_timer_t;
+
+void reset_work_timer(work_timer_t *timer);
+void start_work_timer(work_timer_t *timer);
+// adds the time since start_work_timer to total_us
+void stop_work_timer(work_timer_t *timer);
 
 #endif  // PROJECT_INCLUDE_TIMESTAMPS_H_
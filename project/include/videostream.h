@@ -1,13 +1,76 @@
 #ifndef PIX2ASCII_VIDEO_STREAM_H
 #define PIX2ASCII_VIDEO_STREAM_H
 
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
 #include "argparsing.h"
+#include "timestamps.h"
+
 #define VIDEO_FRAMERATE 25
+#define PLAYER_LOG_LINE_SIZE 1024
+
+typedef struct {
+    pid_t pid;              // -1 when no player is running
+    int log_fd;             // read end of the player's stderr
+    char log_line[PLAYER_LOG_LINE_SIZE];
+    size_t log_line_length;
+    int has_position;
+    int audio_clock;        // audio positions were seen: video positions are ignored from now on
+    double last_pts;        // seconds, as reported by the player
+    double loop_offset;     // seconds played in previous loops
+    timespec position_time; // when last_pts was received
+} player_t;
+
+#define CAPTURE_TIMES_N 64  // frames the capture log remembers
+
+// capture timestamps of a low-latency camera stream, read from ffmpeg's showinfo log
+typedef struct {
+    int log_fd;             // read end of ffmpeg's stderr, -1 when there is none
+    char log_line[PLAYER_LOG_LINE_SIZE];
+    size_t log_line_length;
+    int64_t capture_times_us[CAPTURE_TIMES_N];  // wall clock (CLOCK_REALTIME), by frame number
+    size_t n_reported;      // frames reported so far
+} capture_log_t;
 
 int get_frame_data(const char *filepath, int *frame_width, int *frame_height);
-FILE *get_camera_stream(int frame_width, int frame_height);
 
-FILE *get_file_stream(const char *file_path, int n_stream_loops);
-int start_player(char *file_path, int n_stream_loops, char *player_type);
+// with low_latency_flag set the stream is tuned for latency instead of a steady 25 fps,
+// and capture_log is opened to receive the capture time of every frame
+FILE *get_camera_stream(const ffmpeg_params_t *ffmpeg_params, int frame_width, int frame_height,
+                        capture_log_t *capture_log);
+
+void init_capture_log(capture_log_t *capture_log);
+
+// consumes pending log lines without blocking; returns -1 once ffmpeg has exited
+int update_capture_log(capture_log_t *capture_log);
+
+// wall clock capture time of the frame_number-th frame (counted from 0) in microseconds;
+// -1 if it wasn't reported yet or is too old
+int64_t get_capture_time_us(const capture_log_t *capture_log, size_t frame_number);
+
+void close_capture_log(capture_log_t *capture_log);
+
+FILE *get_file_stream(const char *file_path, int n_stream_loops, double start_time);
+void init_player(player_t *player);
+
+// spawns ffplay without waiting for it; positions show up through update_player_position later
+int spawn_player(player_t *player, char *file_path, int n_stream_loops, char *player_type, double start_time);
+
+// spawns ffplay and blocks (without polling) until it reports its first frame
+int start_player(player_t *player, char *file_path, int n_stream_loops, char *player_type, double start_time);
+
+// SIGSTOP/SIGCONT: the player keeps its position while paused
+void pause_player(player_t *player);
+void resume_player(player_t *player);
+
+// consumes pending player log lines without blocking; returns -1 once the player has exited
+int update_player_position(player_t *player);
+
+// player position (loops included) extrapolated to now; -1 if there is no player clock
+int64_t get_player_time_us(const player_t *player);
+
+void stop_player(player_t *player);
 
 #endif //PIX2ASCII_VIDEO_STREAM_H
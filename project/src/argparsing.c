@@ -5,6 +5,7 @@
 #include <limits.h>
 
 #include "argparsing.h"
+#include "mmapstream.h"
 #include "frame_processing.h"
 #include "status_codes.h"
 
@@ -13,10 +14,14 @@ typedef enum {CHARSET_SHARP, CHARSET_OPTIMAL, CHARSET_STANDARD, CHARSET_LONG, CH
 static charset_params_t charsets[CHARSET_N] = {
         {"@%#*+=-:. ", 9},
         {"NBUa1|^` ", 8},
-        {"N@#W$9876543210?!abc;:+=-,._", 28},
+        {"N@#W$9876543210?!abc;:+=-,._", 27},
         {"$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. ", 69}
 };
 
+#define DEFAULT_EDGE_THRESHOLD 48
+#define DEFAULT_CAMERA_FORMAT "v4l2"
+#define DEFAULT_CAMERA_INPUT "/dev/video0"
+
 typedef enum {PLAYER_OFF, PLAYER_VIDEO, PLAYER_AUDIO, PLAYER_ALL, PLAYER_COUNT} player_t;
 static char *player_flags[PLAYER_COUNT] = {NULL, "-an", "-nodisp", ""};
 
@@ -28,12 +33,24 @@ int argparse(user_params_t *user_params, int argc, char *argv[]) {
     user_params->charset_params = charsets[CHARSET_OPTIMAL];
     user_params->ffmpeg_params.n_stream_loops = 0;
     user_params->ffmpeg_params.player_flag = NULL;
+    user_params->ffmpeg_params.raw_width = 0;
+    user_params->ffmpeg_params.raw_height = 0;
+    user_params->ffmpeg_params.start_time = 0;
+    user_params->ffmpeg_params.camera_format = DEFAULT_CAMERA_FORMAT;
+    user_params->ffmpeg_params.camera_input = DEFAULT_CAMERA_INPUT;
+    user_params->ffmpeg_params.low_latency_flag = 0;
     user_params->frame_processing_params.rgb_channels_processor = average_chanel_intensity;
     user_params->frame_processing_params.update_kernel = update_naive;
+    user_params->frame_processing_params.streaming_flag = 0;
+    user_params->frame_processing_params.edge_flag = 0;
+    user_params->frame_processing_params.edge_threshold = DEFAULT_EDGE_THRESHOLD;
     user_params->terminal_params.color_flag = 0;
     user_params->terminal_params.max_width = INT_MAX;
     user_params->terminal_params.max_height = INT_MAX;
     user_params->terminal_params.preserve_aspect_flag = 0;
+    user_params->terminal_params.capture_path = NULL;
+    user_params->terminal_params.grid_scale = 100;
+    user_params->terminal_params.adaptive_quality_flag = 0;
     for (int i=1; i<argc;) {
         if (argv[i][0] != '-') {
             fprintf(stderr, "Invalid argument! Value is given without a corresponding flag!\n");
@@ -43,12 +60,33 @@ int argparse(user_params_t *user_params, int argc, char *argv[]) {
         if (!strcmp(&argv[i][1], "c")) {
             user_params->ffmpeg_params.reading_type = SOURCE_CAMERA;
             ++i;
+        } else if (!strcmp(&argv[i][1], "camera-format")) {
+            if (i == argc - 1 || argv[i + 1][0] == '-') {
+                fprintf(stderr, "Invalid argument! Camera format was not given!\n");
+                return FLAG_ERROR;
+            }
+            user_params->ffmpeg_params.camera_format = argv[i + 1];
+            user_params->ffmpeg_params.reading_type = SOURCE_CAMERA;
+            i += 2;
+        } else if (!strcmp(&argv[i][1], "camera-input")) {
+            if (i == argc - 1 || argv[i + 1][0] == '-') {
+                fprintf(stderr, "Invalid argument! Camera input was not given!\n");
+                return FLAG_ERROR;
+            }
+            // -camera-format lavfi -camera-input testsrc2=rate=30,realtime stands in for a camera
+            user_params->ffmpeg_params.camera_input = argv[i + 1];
+            user_params->ffmpeg_params.reading_type = SOURCE_CAMERA;
+            i += 2;
+        } else if (!strcmp(&argv[i][1], "-low-latency")) {
+            user_params->ffmpeg_params.low_latency_flag = 1;
+            ++i;
         } else if (!strcmp(&argv[i][1], "f")) {
             if (i == argc - 1 || argv[i + 1][0] == '-') {
                 fprintf(stderr, "Invalid argument! File path was not given!\n");
                 return FLAG_ERROR;
             } else {
-                user_params->ffmpeg_params.reading_type = SOURCE_FILE;
+                // preprocessed raw/y4m files are mapped into memory instead of being decoded
+                user_params->ffmpeg_params.reading_type = is_mapped_source(argv[i + 1]) ? SOURCE_MAPPED : SOURCE_FILE;
                 user_params->ffmpeg_params.file_path = argv[i + 1];
                 i += 2;
             }
@@ -99,6 +137,26 @@ int argparse(user_params_t *user_params, int argc, char *argv[]) {
         } else if (!strcmp(&argv[i][1], "-keep-aspect")) {
             user_params->terminal_params.preserve_aspect_flag = 1;
             ++i;
+        } else if (!strcmp(&argv[i][1], "-adaptive")) {
+            user_params->terminal_params.adaptive_quality_flag = 1;
+            ++i;
+        } else if (!strcmp(&argv[i][1], "-edges")) {
+            user_params->frame_processing_params.edge_flag = 1;
+            ++i;
+        } else if (!strcmp(&argv[i][1], "edge-threshold")) {
+            int edge_threshold;
+            char trailing;
+            // 0 would turn every textured cell into an edge glyph
+            if (i == argc - 1 || sscanf(argv[i + 1], "%d%c", &edge_threshold, &trailing) != 1 ||
+                edge_threshold < 1 || edge_threshold > 255) {
+                fprintf(stderr, "Invalid argument! Edge threshold should be a number from 1 to 255!\n");
+                return FLAG_ERROR;
+            }
+            user_params->frame_processing_params.edge_threshold = edge_threshold;
+            i += 2;
+        } else if (!strcmp(&argv[i][1], "-stream")) {
+            user_params->frame_processing_params.streaming_flag = 1;
+            ++i;
         } else if (!strcmp(&argv[i][1], "nl")) {
             user_params->ffmpeg_params.n_stream_loops = atoi(argv[i + 1]);
             i += 2;
@@ -131,6 +189,8 @@ int argparse(user_params_t *user_params, int argc, char *argv[]) {
                 user_params->frame_processing_params.update_kernel = update_naive;
             } else if (!strcmp(argv[i + 1], "gauss")) {
                 user_params->frame_processing_params.update_kernel = update_gaussian;
+            } else if (!strcmp(argv[i + 1], "area")) {
+                user_params->frame_processing_params.update_kernel = update_area;
             } else {
                 fprintf(stderr, "Invalid argument! Unsupported filter type!\n");
                 return NOT_IMPLEMENTED_ERROR;
@@ -150,26 +210,56 @@ int argparse(user_params_t *user_params, int argc, char *argv[]) {
             }
             user_params->terminal_params.max_height = atoi(argv[i + 1]);
             i += 2;
+        } else if (!strcmp(&argv[i][1], "size")) {
+            if (i == argc - 1 || sscanf(argv[i + 1], "%dx%d", &user_params->ffmpeg_params.raw_width,
+                                        &user_params->ffmpeg_params.raw_height) != 2) {
+                fprintf(stderr, "Invalid argument! Frame size should be given as WxH!\n");
+                return FLAG_ERROR;
+            }
+            i += 2;
+        } else if (!strcmp(&argv[i][1], "ss")) {
+            if (i == argc - 1 || argv[i + 1][0] == '-') {
+                fprintf(stderr, "Invalid argument! Start time was not given!\n");
+                return FLAG_ERROR;
+            }
+            user_params->ffmpeg_params.start_time = atof(argv[i + 1]);
+            i += 2;
+        } else if (!strcmp(&argv[i][1], "o")) {
+            if (i == argc - 1 || argv[i + 1][0] == '-') {
+                fprintf(stderr, "Invalid argument! Output file was not given!\n");
+                return FLAG_ERROR;
+            }
+            user_params->terminal_params.capture_path = argv[i + 1];
+            i += 2;
         } else if (!strcmp(&argv[i][1], "h")) {
              printf("%s\n",
                     "flags:\n"
-                    "-f <Media path>\n"
+                    "-f <Media path> : .rgb/.raw (rgb24) and .y4m files are memory-mapped\n"
+                    "-size WxH : frame size of raw rgb24 files\n"
+                    "-ss <seconds> : start position\n"
                     "-c : (camera support)\n"
+                    "-camera-format <format> -camera-input <input> : ffmpeg input of the camera (v4l2 /dev/video0)\n"
+                    "--low-latency : camera frames are drawn as soon as they arrive, older ones are dropped\n"
                     "-set [sharp | optimal | standard | long] : ascii set\n"
                     "-method [average | yuv] : RGB channels combining method\n"
                     "-nl : loop video; -1 for infinite loop\n"
                     "-player [0 - off; 1 - only video; 2 - only audio; 3 - video and audio]\n"
-                    "-filter [naive | gauss]\n"
+                    "-filter [naive | gauss | area] : area fills the grid exactly, without trimming the frame\n"
                     "-maxw: sets maximum produced width\n"
                     "-maxh: set max produced height\n"
+                    "-o <Output path>: headless mode, write frames as text (/dev/null to discard)\n"
                     "--color : terminal colorization flag\n"
-                    "--keep-aspect: Enable aspect ratio");
+                    "--keep-aspect: Enable aspect ratio\n"
+                    "--edges: draw /\\|- along edges instead of brightness glyphs\n"
+                    "-edge-threshold <1-255>: gradient needed for an edge glyph (default 48)\n"
+                    "--stream: convert frames in row bands as they arrive (low memory)\n"
+                    "--adaptive: lower quality under load to keep the frame rate\n"
+                    "keys: space/p - pause, s - step, left/right - seek 10 s, down/up - seek 60 s, q - quit");
             return HELP_FLAG;
         } else {
             fprintf(stderr, "Unknown flag!\n");
             return FLAG_ERROR;
         }
     }
-
     return SUCCESS;
 }
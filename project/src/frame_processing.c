@@ -55,40 +55,34 @@ int update_gaussian(double **kernel, int width, int height) {
     return SUCCESS;
 }
 
+int update_area(double **kernel, int width, int height) {
+    (void) width;
+    (void) height;
+    free(*kernel);
+    *kernel = NULL;
+    return SUCCESS;
+}
+
 void convolve(const frame_params_t *frame_params,
               const kernel_params_t *kernel_params,
               int cur_pixel_row,
               int cur_pixel_col,
               double *r, double *g, double *b) {
-    double local_r = 0, local_g = 0, local_b =0;
-
-    int down_row = cur_pixel_row + kernel_params->width;
-    int right_col = cur_pixel_col + kernel_params->height;
-
-    int triple_cur_pixel_col = cur_pixel_col * 3;
-    int c = 0;
-    for (int row_offset = frame_params->triple_width * cur_pixel_row, i = cur_pixel_row;
-         i < down_row;
-         row_offset += frame_params->triple_width, ++i) {
-        for (int col_offset = triple_cur_pixel_col, j = cur_pixel_col;
-             j < right_col;
-             col_offset += 3, ++j) {
-            local_r += kernel_params->kernel[c] * frame_params->video_frame[row_offset + col_offset];
-            local_g += kernel_params->kernel[c] * frame_params->video_frame[row_offset + col_offset + 1];
-            local_b += kernel_params->kernel[c] * frame_params->video_frame[row_offset + col_offset + 2];
-            ++c;
-        }
-    }
-    *r = local_r;
-    *g = local_g;
-    *b = local_b;
+    convolve_weighted(frame_params, kernel_params, cur_pixel_row, cur_pixel_col, r, g, b);
+}
+
+uint64_t tile_hash(const frame_params_t *frame_params,
+                   const kernel_params_t *kernel_params,
+                   int cur_pixel_row,
+                   int cur_pixel_col) {
+    return tile_hash_inline(frame_params, kernel_params, cur_pixel_row, cur_pixel_col);
 }
 
 unsigned char average_chanel_intensity(double r, double g, double b) {
-    return (unsigned char) ((r + g + b) / 3);
+    return average_chanel_intensity_inline(r, g, b);
 }
 
 
 unsigned char yuv_intensity(double r, double g, double b) {
-    return (unsigned char) (r * 0.299 + 0.587 * g + 0.114 * b);
+    return yuv_intensity_inline(r, g, b);
 }
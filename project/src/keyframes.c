@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "keyframes.h"
+#include "status_codes.h"
+
+#define COMMAND_BUFFER_SIZE 512
+#define INDEX_HEADER "# pix2ascii keyframe index"
+#define INDEX_LINE_SIZE 128
+#define PATH_BUFFER_SIZE 4096
+
+void init_keyframe_index(keyframe_index_t *index) {
+    index->times = NULL;
+    index->n_keyframes = 0;
+    index->duration = 0;
+}
+
+void free_keyframe_index(keyframe_index_t *index) {
+    free(index->times);
+    init_keyframe_index(index);
+}
+
+static int push_keyframe(keyframe_index_t *index, size_t *capacity, double time) {
+    if (index->n_keyframes == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        double *new_times = realloc(index->times, sizeof(double) * new_capacity);
+        if (!new_times) {
+            fprintf(stderr, "Couldn't allocate memory for keyframe index!");
+            return CACHE_ALLOCATION_ERROR;
+        }
+        index->times = new_times;
+        *capacity = new_capacity;
+    }
+    // packets come in decoding order: a keyframe may only be reordered behind its neighbour
+    size_t i = index->n_keyframes++;
+    for (; i && index->times[i - 1] > time; --i)
+        index->times[i] = index->times[i - 1];
+    index->times[i] = time;
+    return SUCCESS;
+}
+
+static void get_index_path(const char *file_path, char *index_path, size_t size) {
+    snprintf(index_path, size, "%s%s", file_path, KEYFRAME_INDEX_EXTENSION);
+}
+
+// cache format: header line, "size <bytes of the file>", "duration <seconds>",
+// then one keyframe time per line
+static int read_index_cache(keyframe_index_t *index, const char *file_path) {
+    char index_path[PATH_BUFFER_SIZE];
+    get_index_path(file_path, index_path, sizeof(index_path));
+    struct stat file_stat, index_stat;
+    if (stat(file_path, &file_stat) || stat(index_path, &index_stat) ||
+        index_stat.st_mtime < file_stat.st_mtime)
+        return FOPEN_ERROR;
+
+    FILE *index_file = fopen(index_path, "r");
+    if (!index_file)
+        return FOPEN_ERROR;
+    char line[INDEX_LINE_SIZE];
+    size_t capacity = 0;
+    int return_status = SUCCESS;
+    long long file_size;
+    // the size catches a file rewritten within the second its index was written in
+    if (!fgets(line, sizeof(line), index_file) || strncmp(line, INDEX_HEADER, strlen(INDEX_HEADER)) ||
+        fscanf(index_file, " size %lld", &file_size) != 1 || file_size != (long long) file_stat.st_size ||
+        fscanf(index_file, " duration %lf", &index->duration) != 1) {
+        return_status = FOPEN_ERROR;
+    } else {
+        double time;
+        while (!return_status && fscanf(index_file, "%lf", &time) == 1)
+            return_status = push_keyframe(index, &capacity, time);
+    }
+    fclose(index_file);
+    if (return_status)
+        free_keyframe_index(index);
+    return return_status;
+}
+
+static void write_index_cache(const keyframe_index_t *index, const char *file_path) {
+    char index_path[PATH_BUFFER_SIZE];
+    get_index_path(file_path, index_path, sizeof(index_path));
+    struct stat file_stat;
+    if (stat(file_path, &file_stat))
+        return;
+    FILE *index_file = fopen(index_path, "w");
+    if (!index_file)  // read-only location: the index just isn't reused next time
+        return;
+    fprintf(index_file, "%s\nsize %lld\nduration %f\n", INDEX_HEADER, (long long) file_stat.st_size,
+            index->duration);
+    for (size_t i = 0; i < index->n_keyframes; ++i)
+        fprintf(index_file, "%f\n", index->times[i]);
+    fclose(index_file);
+}
+
+static int probe_keyframes(keyframe_index_t *index, const char *file_path) {
+    char command_buffer[COMMAND_BUFFER_SIZE];
+    int n_chars_printed = snprintf(command_buffer, COMMAND_BUFFER_SIZE,
+                                   "ffprobe -v error -select_streams v:0"
+                                   " -show_entries packet=pts_time,duration_time,flags"
+                                   " -of csv=p=0 %s",
+                                   file_path);
+    if (n_chars_printed < 0 || n_chars_printed >= COMMAND_BUFFER_SIZE) {
+        fprintf(stderr, "Error preparing ffprobe command!\n");
+        return POPEN_ERROR;
+    }
+    FILE *probe_pipe = popen(command_buffer, "r");
+    if (!probe_pipe) {
+        fprintf(stderr, "Error building keyframe index! Couldn't get an interface with ffprobe!\n");
+        return POPEN_ERROR;
+    }
+
+    // "<pts_time>,<duration_time>,<flags>" per packet, K in flags marks a keyframe
+    char line[INDEX_LINE_SIZE];
+    size_t capacity = 0;
+    int return_status = SUCCESS;
+    while (!return_status && fgets(line, sizeof(line), probe_pipe)) {
+        char *field_end;
+        double pts = strtod(line, &field_end);
+        if (field_end == line || *field_end != ',')
+            continue;  // packets without a timestamp
+        double duration = strtod(field_end + 1, NULL);  // 0 for N/A
+        if (pts + duration > index->duration)
+            index->duration = pts + duration;
+        char *flags = strrchr(line, ',');
+        if (flags[1] == 'K')
+            return_status = push_keyframe(index, &capacity, pts);
+    }
+    if (pclose(probe_pipe) || !index->n_keyframes) {
+        free_keyframe_index(index);
+        return return_status ? return_status : POPEN_ERROR;
+    }
+    return return_status;
+}
+
+int load_keyframe_index(keyframe_index_t *index, const char *file_path) {
+    init_keyframe_index(index);
+    if (!read_index_cache(index, file_path))
+        return SUCCESS;
+
+    int return_status;
+    if ((return_status = probe_keyframes(index, file_path)))
+        return return_status;
+    write_index_cache(index, file_path);
+    return SUCCESS;
+}
+
+double find_keyframe(const keyframe_index_t *index, double time) {
+    if (!index->n_keyframes || time < index->times[0])
+        return time;
+    size_t low = 0, high = index->n_keyframes;  // times[low] <= time < times[high]
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (index->times[middle] <= time)
+            low = middle;
+        else
+            high = middle;
+    }
+    return index->times[low];
+}
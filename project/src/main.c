@@ -1,25 +1,299 @@
 #include <ncurses.h>
+#include <poll.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include "videostream.h"
+#include "pipestream.h"
+#include "mmapstream.h"
+#include "keyframes.h"
 #include "frame_processing.h"
 #include "timestamps.h"
 #include "argparsing.h"
 #include "termstream.h"
 #include "status_codes.h"
+#include "quality.h"
+#include "utils.h"
 
 
-static void close_pipe(FILE *pipeline) {
-    fflush(pipeline);
-    pclose(pipeline);
+static void free_space(unsigned char *video_frame, pipe_stream_t *video_stream, FILE *logs_file) {
+    free(video_frame);
+    close_pipe_stream(video_stream);
+    if (logs_file)
+        fclose(logs_file);
 }
 
-static void free_space(unsigned char *video_frame, FILE *pipeline, FILE *logs_file) {
-    free(video_frame);
-    close_pipe(pipeline);
-    fflush(logs_file);
-    fclose(logs_file);
+// drops n_bytes from the pipe, going through a buffer that may be smaller than a frame
+static void skip_bytes(pipe_stream_t *video_stream, unsigned char *buffer, size_t buffer_size, size_t n_bytes) {
+    size_t n_read;
+    while (n_bytes && (n_read = read_pipe_stream(video_stream, buffer, MIN(buffer_size, n_bytes))))
+        n_bytes -= n_read;
+}
+
+// makes the frame buffer and the pipe big enough for one band (pixel rows of a single character row)
+static int fit_band(frame_params_t *frame_params,
+                    const kernel_params_t *kernel_params,
+                    pipe_stream_t *video_stream,
+                    size_t *buffer_size) {
+    size_t band_size = (size_t) frame_params->triple_width * kernel_params->width;
+    if (band_size <= *buffer_size)
+        return SUCCESS;
+
+    // band contents don't have to survive a resize, so no need for realloc
+    unsigned char *new_band = alloc_frame_slot(sizeof(unsigned char) * band_size);
+    if (!new_band) {
+        fprintf(stderr, "Couldn't allocate memory for frame band!");
+        return FRAME_ALLOCATION_ERROR;
+    }
+    free(frame_params->video_frame);
+    frame_params->video_frame = new_band;
+    *buffer_size = band_size;
+    resize_pipe_stream(video_stream, band_size);
+    return SUCCESS;
+}
+
+// reads a frame band by band and draws every character row as soon as its band arrived,
+// so only one band is resident at a time; only the conversions are added to frame_work,
+// not the waits for the bands; returns the number of bytes read
+static size_t stream_frame(pipe_stream_t *video_stream,
+                           const frame_params_t *frame_params,
+                           const kernel_params_t *kernel_params,
+                           const user_params_t *user_params,
+                           draw_row_method_t draw_row,
+                           cell_cache_t *cell_cache,
+                           work_timer_t *frame_work) {
+    size_t band_size = (size_t) frame_params->triple_width * kernel_params->width;
+    size_t n_read_items = 0, n_band_items;
+    for (int cur_char_row = 0, cur_pixel_row = 0;
+         cur_pixel_row < frame_params->trimmed_height;
+         ++cur_char_row, cur_pixel_row += kernel_params->width) {
+        n_band_items = read_pipe_stream(video_stream, frame_params->video_frame, band_size);
+        n_read_items += n_band_items;
+        if (n_band_items < band_size)
+            return n_read_items;
+        start_work_timer(frame_work);
+        draw_row(frame_params, kernel_params, user_params->charset_params,
+                 user_params->frame_processing_params.edge_threshold,
+                 user_params->terminal_params.left_border_indent,
+                 cell_cache, cur_char_row, 0);
+        stop_work_timer(frame_work);
+    }
+    // trimmed rows below the last character row are never displayed
+    n_read_items += read_pipe_stream(video_stream, frame_params->video_frame,
+                                     (size_t) frame_params->triple_width *
+                                     (frame_params->height - frame_params->trimmed_height));
+    return n_read_items;
+}
+
+// switches filter, output and grid size to the given rung of the quality ladder
+static void apply_quality_step(const quality_step_t *step,
+                               user_params_t *user_params,
+                               kernel_params_t *kernel_params,
+                               draw_row_method_t *draw_row,
+                               cell_cache_t *cell_cache) {
+    kernel_params->update_kernel = step->update_kernel;
+    user_params->terminal_params.grid_scale = step->grid_scale;
+    *draw_row = get_draw_row_method(step->update_kernel,
+                                    user_params->frame_processing_params.rgb_channels_processor,
+                                    step->output,
+                                    user_params->frame_processing_params.edge_flag);
+    invalidate_cell_cache(cell_cache);
+    force_terminal_update();  // rebuilds the kernel for the new filter/grid
+}
+
+#define HEADLESS_DEFAULT_ROWS 24
+#define HEADLESS_DEFAULT_COLS 80
+// a smaller camera frame fits into the pipe whole and is converted faster
+#define LOW_LATENCY_FRAME_WIDTH 640
+#define LOW_LATENCY_FRAME_HEIGHT 360
+
+#define PENDING_LATENCIES_N 16  // shown frames waiting for their capture time
+
+typedef struct {
+    size_t n_samples;
+    uint64_t total_us;
+    uint64_t max_us;
+    size_t n_unknown;  // shown frames whose capture time never arrived
+    // the showinfo line of a frame may arrive after the frame data, so shown frames wait here
+    size_t pending_frames[PENDING_LATENCIES_N];
+    int64_t pending_display_us[PENDING_LATENCIES_N];  // wall clock
+    size_t n_pending;
+    size_t last_latency_us;  // latest known latency, CAPTURE_LATENCY_UNKNOWN before the first one
+} latency_stats_t;
+
+static void init_latency_stats(latency_stats_t *stats) {
+    stats->n_samples = 0;
+    stats->total_us = 0;
+    stats->max_us = 0;
+    stats->n_unknown = 0;
+    stats->n_pending = 0;
+    stats->last_latency_us = CAPTURE_LATENCY_UNKNOWN;
+}
+
+static void drop_pending_latency(latency_stats_t *stats, size_t i) {
+    --stats->n_pending;
+    memmove(&stats->pending_frames[i], &stats->pending_frames[i + 1],
+            (stats->n_pending - i) * sizeof(stats->pending_frames[0]));
+    memmove(&stats->pending_display_us[i], &stats->pending_display_us[i + 1],
+            (stats->n_pending - i) * sizeof(stats->pending_display_us[0]));
+}
+
+// times every pending frame whose capture time has been logged by now;
+// frames the log has already forgotten count as unknown
+static void resolve_capture_latencies(capture_log_t *capture_log, latency_stats_t *stats) {
+    update_capture_log(capture_log);
+    for (size_t i = 0; i < stats->n_pending;) {
+        int64_t capture_time_us = get_capture_time_us(capture_log, stats->pending_frames[i]);
+        if (capture_time_us >= 0) {
+            size_t latency_us = (size_t) MAX(stats->pending_display_us[i] - capture_time_us, 0);
+            ++stats->n_samples;
+            stats->total_us += latency_us;
+            stats->max_us = MAX(stats->max_us, latency_us);
+            stats->last_latency_us = latency_us;
+        } else if (stats->pending_frames[i] < capture_log->n_reported) {
+            ++stats->n_unknown;
+        } else {
+            ++i;  // not logged yet
+            continue;
+        }
+        drop_pending_latency(stats, i);
+    }
+}
+
+// notes the display time of a shown frame and resolves whatever the log has reported so far
+static void record_capture_latency(capture_log_t *capture_log, size_t frame_number, latency_stats_t *stats) {
+    if (stats->n_pending == PENDING_LATENCIES_N) {
+        ++stats->n_unknown;
+        drop_pending_latency(stats, 0);
+    }
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);  // capture stamps are wall clock times
+    stats->pending_frames[stats->n_pending] = frame_number;
+    stats->pending_display_us[stats->n_pending++] = (int64_t) now.tv_sec * N_uSECONDS_IN_ONE_SEC +
+                                                    now.tv_nsec / 1000;
+    resolve_capture_latencies(capture_log, stats);
+}
+
+// wall clock part of the playback clock, restarted wherever playback jumps or resumes
+typedef struct {
+    timespec origin;
+    size_t origin_us;  // playback position at origin
+} playback_clock_t;
+
+static void reset_playback_clock(playback_clock_t *clock, size_t position_us) {
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &clock->origin);
+    clock->origin_us = position_us;
+}
+
+// playback clock: the player's position while it runs, so ASCII frames follow its audio,
+// wall time since the last jump otherwise
+static size_t get_playback_time_us(player_t *player, const playback_clock_t *clock) {
+    update_player_position(player);
+    int64_t player_time_us = get_player_time_us(player);
+    return player_time_us >= 0
+            ? (size_t) player_time_us
+            : clock->origin_us + get_elapsed_time_from_start_us(clock->origin);
+}
+
+#define SEEK_STEP_SHORT 10.0  // seconds, left/right
+#define SEEK_STEP_LONG 60.0   // seconds, down/up
+
+typedef struct {
+    int paused;
+    int step;           // draw a single frame while paused
+    int quit;
+    double seek_delta;  // seconds, accumulated until the next frame
+} playback_controls_t;
+
+// ffplay's keys: space/p - pause, s - step one frame, left/right - 10 s, down/up - 60 s, q - quit
+static void read_controls(playback_controls_t *controls) {
+    int key;
+    while ((key = getch()) != ERR) {
+        switch (key) {
+            case ' ':
+            case 'p':
+                controls->paused = !controls->paused;
+                break;
+            case 's':
+                controls->paused = 1;
+                controls->step = 1;
+                break;
+            case KEY_LEFT:
+                controls->seek_delta -= SEEK_STEP_SHORT;
+                break;
+            case KEY_RIGHT:
+                controls->seek_delta += SEEK_STEP_SHORT;
+                break;
+            case KEY_DOWN:
+                controls->seek_delta -= SEEK_STEP_LONG;
+                break;
+            case KEY_UP:
+                controls->seek_delta += SEEK_STEP_LONG;
+                break;
+            case 'q':
+                controls->quit = 1;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// moves the decoder (and the player) to the exact target; ffmpeg loops on its own, so the seek stays in the
+// current pass. Input seeking decodes from the keyframe before the target anyway, so a forward seek that
+// passes no keyframe reads on from the running decoder instead of starting over
+static int seek_file_source(double delta,
+                            ffmpeg_params_t *ffmpeg_params,
+                            const keyframe_index_t *keyframe_index,
+                            pipe_stream_t *video_stream,
+                            player_t *player,
+                            unsigned char *buffer,
+                            size_t buffer_size,
+                            size_t frame_size,
+                            size_t *frame_index) {
+    double position = (double) *frame_index / VIDEO_FRAMERATE;
+    size_t n_loop = (keyframe_index->duration > 0) ? (size_t) (position / keyframe_index->duration) : 0;
+    double loop_start = n_loop * keyframe_index->duration;
+    double target = MAX(position - loop_start + delta, 0);
+    if (keyframe_index->duration > 0)
+        target = MIN(target, keyframe_index->duration);
+    size_t target_index = (size_t) ((loop_start + target) * VIDEO_FRAMERATE + 0.5);
+    if (delta > 0)  // rounding mustn't take a forward seek back
+        target_index = MAX(target_index, *frame_index);
+    else
+        target_index = MIN(target_index, *frame_index);
+    int n_loops_left = (ffmpeg_params->n_stream_loops < 0) ? -1 : ffmpeg_params->n_stream_loops - (int) n_loop;
+
+    int return_status;
+    // an older player may still hold the decoder pipe, pclose would wait on it
+    stop_player(player);
+    if (delta > 0 && find_keyframe(keyframe_index, target) <= position - loop_start) {
+        skip_bytes(video_stream, buffer, buffer_size, (target_index - *frame_index) * frame_size);
+    } else {
+        close_pipe_stream(video_stream);
+        FILE *pipein = get_file_stream(ffmpeg_params->file_path, n_loops_left, target);
+        if (!pipein)
+            return POPEN_ERROR;
+        // the buffer holds what a single read asks for: the frame, or the band when streaming
+        if ((return_status = open_pipe_stream(video_stream, pipein, buffer_size)))
+            return return_status;
+    }
+
+    // the new player isn't waited for: the wall clock covers its startup
+    if ((return_status = spawn_player(player, ffmpeg_params->file_path, n_loops_left + 1,
+                                      ffmpeg_params->player_flag, target)))
+        return return_status;
+    player->loop_offset = loop_start;
+    *frame_index = target_index;
+    return SUCCESS;
+}
+
+// sleeps until there is input, paused playback has nothing else to do
+static void wait_for_key() {
+    struct pollfd input_poll = {STDIN_FILENO, POLLIN, 0};
+    poll(&input_poll, 1, -1);
 }
 
 int main(int argc, char *argv[]) {
@@ -33,11 +307,45 @@ int main(int argc, char *argv[]) {
 
     FILE *pipein = NULL;
     frame_params_t frame_data;
+    cell_cache_t cell_cache;
+    init_cell_cache(&cell_cache);
 
     frame_data.width = 1280;
     frame_data.height = 720;
-    if (user_params.ffmpeg_params.reading_type == SOURCE_FILE) {
-        if (!(pipein = get_file_stream(user_params.ffmpeg_params.file_path, user_params.ffmpeg_params.n_stream_loops))) {
+    player_t player;
+    init_player(&player);
+    mapped_stream_t mapped_stream;
+    init_mapped_stream(&mapped_stream);
+    keyframe_index_t keyframe_index;
+    init_keyframe_index(&keyframe_index);
+    capture_log_t capture_log;
+    init_capture_log(&capture_log);
+    latest_frame_t latest_frame;
+    init_latest_frame(&latest_frame);
+    latency_stats_t latency_stats;
+    init_latency_stats(&latency_stats);
+    int low_latency_flag = user_params.ffmpeg_params.low_latency_flag &&
+                           user_params.ffmpeg_params.reading_type == SOURCE_CAMERA;
+    // seek/pause/step from the keyboard, only for files played in the terminal
+    int interactive_flag = !user_params.terminal_params.capture_path &&
+                           user_params.ffmpeg_params.reading_type != SOURCE_CAMERA;
+    double start_time = user_params.ffmpeg_params.start_time;
+    if (user_params.ffmpeg_params.reading_type == SOURCE_MAPPED) {
+        // no decoder and no player: frames are addressed straight in the file's mapping
+        if ((return_status = open_mapped_stream(&mapped_stream, user_params.ffmpeg_params.file_path,
+                                                user_params.ffmpeg_params.raw_width,
+                                                user_params.ffmpeg_params.raw_height,
+                                                user_params.ffmpeg_params.n_stream_loops)))
+            return return_status;
+        seek_mapped_stream(&mapped_stream, user_params.ffmpeg_params.start_time);
+        frame_data.width = mapped_stream.width;
+        frame_data.height = mapped_stream.height;
+    } else if (user_params.ffmpeg_params.reading_type == SOURCE_FILE) {
+        // without an index seeks still work, they just always restart the decoder
+        if (interactive_flag)
+            load_keyframe_index(&keyframe_index, user_params.ffmpeg_params.file_path);
+        if (!(pipein = get_file_stream(user_params.ffmpeg_params.file_path, user_params.ffmpeg_params.n_stream_loops,
+                                       start_time))) {
             // ...
             return POPEN_ERROR;
         }
@@ -45,14 +353,19 @@ int main(int argc, char *argv[]) {
             // ...
             return return_status;
         }
-        if ((return_status = start_player(user_params.ffmpeg_params.file_path,
+        if ((return_status = start_player(&player, user_params.ffmpeg_params.file_path,
                                           user_params.ffmpeg_params.n_stream_loops + 1,
-                                          user_params.ffmpeg_params.player_flag))) {
+                                          user_params.ffmpeg_params.player_flag, start_time))) {
             // ...
             return return_status;
         }
     } else if (user_params.ffmpeg_params.reading_type == SOURCE_CAMERA) {
-        if (!(pipein = get_camera_stream(frame_data.width, frame_data.height))) {
+        if (low_latency_flag) {
+            frame_data.width = LOW_LATENCY_FRAME_WIDTH;
+            frame_data.height = LOW_LATENCY_FRAME_HEIGHT;
+        }
+        if (!(pipein = get_camera_stream(&user_params.ffmpeg_params, frame_data.width, frame_data.height,
+                                         &capture_log))) {
             // ...
             return POPEN_ERROR;
         }
@@ -61,23 +374,52 @@ int main(int argc, char *argv[]) {
         return NOT_IMPLEMENTED_ERROR;
     }
 
-    timespec startTime;
+    frame_data.aspect_ratio = frame_data.width / frame_data.height;
+    frame_data.triple_width = frame_data.width * 3;
+    size_t TOTAL_READ_SIZE = (size_t) frame_data.triple_width * frame_data.height;
+
+    // mapped sources are never streamed, they have no pipe to stream from;
+    // neither are area footprints, neighbouring ones share their border pixel row,
+    // nor low-latency frames, only complete ones compete for being the latest
+    int streaming_flag = user_params.frame_processing_params.streaming_flag &&
+                         user_params.ffmpeg_params.reading_type != SOURCE_MAPPED &&
+                         user_params.frame_processing_params.update_kernel != update_area &&
+                         !low_latency_flag;
+
+    pipe_stream_t video_stream;
+    init_pipe_stream(&video_stream);
+    // a streamed pipe starts at one pixel row and grows with the band in fit_band;
+    // the player is already running from here on, so failures have to stop it
+    if (pipein && (return_status = open_pipe_stream(&video_stream, pipein,
+                                                    streaming_flag ? (size_t) frame_data.triple_width
+                                                                   : TOTAL_READ_SIZE))) {
+        stop_player(&player);
+        return return_status;
+    }
+    if (low_latency_flag && (return_status = open_latest_frame(&latest_frame, TOTAL_READ_SIZE))) {
+        stop_player(&player);
+        return return_status;
+    }
+
+    timespec startTime, summary_start;
     clock_gettime(CLOCK_MONOTONIC_COARSE, &startTime);
+    clock_gettime(CLOCK_MONOTONIC, &summary_start);  // a coarse tick is a large part of a short run
 
-    FILE *logs = fopen("Logs.txt", "w");
-    if (!logs) {
+    // the stats line is only drawn in the terminal, headless runs leave no log behind
+    FILE *logs = NULL;
+    if (!user_params.terminal_params.capture_path && !(logs = fopen("Logs.txt", "w"))) {
         fprintf(stderr, "Couldn't open log file!");
+        stop_player(&player);
         return FOPEN_ERROR;
     }
 
-    frame_data.aspect_ratio = frame_data.width / frame_data.height;
-    frame_data.triple_width = frame_data.width * 3;
-    int TOTAL_READ_SIZE = frame_data.triple_width * frame_data.height;
-    frame_data.video_frame = malloc(sizeof(unsigned char) * TOTAL_READ_SIZE);
-    if (!frame_data.video_frame) {
-        fprintf(stderr, "Couldn't allocate memory for frame!");
-        return_status = FRAME_ALLOCATION_ERROR;
-        goto free_memory;
+    // headless mode: no terminal, no pacing, every frame is converted and written as text
+    FILE *capture = NULL;
+    if (user_params.terminal_params.capture_path &&
+        !(capture = fopen(user_params.terminal_params.capture_path, "w"))) {
+        fprintf(stderr, "Couldn't open output file!");
+        stop_player(&player);
+        return FOPEN_ERROR;
     }
 
     sync_info_t frame_sync_info;
@@ -85,6 +427,31 @@ int main(int argc, char *argv[]) {
     frame_sync_info.frame_index = 0;
     frame_sync_info.time_frame_index = 0;
     frame_sync_info.frame_desync = 0;
+    frame_sync_info.cur_frame_processing_time = 0;
+    frame_sync_info.n_reused_cells = 0;
+    frame_sync_info.quality_level = 0;
+    frame_sync_info.pipe_occupancy = 0;
+    frame_sync_info.n_short_reads = 0;
+    frame_sync_info.seek_latency_us = 0;
+    frame_sync_info.capture_latency_us = low_latency_flag ? CAPTURE_LATENCY_UNKNOWN : 0;
+    // frames are numbered from the start of the file, wherever playback starts
+    frame_sync_info.frame_index = (size_t) (start_time * VIDEO_FRAMERATE + 0.5);
+    size_t n_drawn_frames = 0;
+    playback_controls_t controls = {0, 0, 0, 0};
+
+    // in streaming mode the buffer only ever holds one band and grows with the kernel;
+    // mapped and low-latency frames are drawn from their own slots, so the buffer is only a placeholder for them
+    size_t frame_buffer_size = (streaming_flag || low_latency_flag ||
+                                user_params.ffmpeg_params.reading_type == SOURCE_MAPPED)
+            ? (size_t) frame_data.triple_width
+            : TOTAL_READ_SIZE;
+    frame_data.video_frame = alloc_frame_slot(sizeof(unsigned char) * frame_buffer_size);
+    if (!frame_data.video_frame) {
+        fprintf(stderr, "Couldn't allocate memory for frame!");
+        return_status = FRAME_ALLOCATION_ERROR;
+        goto free_memory;
+    }
+
     size_t prev_uS_elapsed, sleep_time;
     size_t frame_timing_sleep = N_uSECONDS_IN_ONE_SEC / VIDEO_FRAMERATE;
 
@@ -92,39 +459,181 @@ int main(int argc, char *argv[]) {
     kernel_data.kernel = NULL;
     kernel_data.update_kernel = user_params.frame_processing_params.update_kernel;
 
-    initscr();
-    curs_set(0);
-    display_method_t symbol_display_method;
-    if (user_params.terminal_params.color_flag) {
-        start_color();
-        set_color_pairs();
-        symbol_display_method = colored_display;
+    display_method_t symbol_display_method = simple_display;
+    output_t output = OUTPUT_SIMPLE;
+    if (capture) {
+        output = OUTPUT_HEADLESS;
+        // there is no terminal to measure: -maxh/-maxw define the grid
+        int n_rows = (user_params.terminal_params.max_height == INT_MAX)
+                ? HEADLESS_DEFAULT_ROWS
+                : user_params.terminal_params.max_height;
+        int n_cols = (user_params.terminal_params.max_width == INT_MAX)
+                ? HEADLESS_DEFAULT_COLS
+                : user_params.terminal_params.max_width;
+        if ((return_status = update_grid_size(&frame_data, &kernel_data, &user_params.terminal_params,
+                                              n_rows, n_cols)))
+            goto free_memory;
     } else {
-        symbol_display_method = simple_display;
+        initscr();
+        curs_set(0);
+        if (interactive_flag) {
+            cbreak();
+            noecho();
+            keypad(stdscr, TRUE);
+            nodelay(stdscr, TRUE);
+        }
+        if (user_params.terminal_params.color_flag) {
+            start_color();
+            set_color_pairs();
+            symbol_display_method = colored_display;
+            output = OUTPUT_COLORED;
+        }
     }
+    draw_row_method_t draw_row = get_draw_row_method(user_params.frame_processing_params.update_kernel,
+                                                     user_params.frame_processing_params.rgb_channels_processor,
+                                                     output,
+                                                     user_params.frame_processing_params.edge_flag);
+
+    quality_controller_t quality_controller;
+    init_quality_controller(&quality_controller, kernel_data.update_kernel, output, frame_timing_sleep);
+    work_timer_t frame_work;  // time spent on the frame itself, waits for the source excluded
+
+    timespec seek_start_time;
+    int seek_pending_flag = 0;  // the first frame at a new position hasn't been shown yet
 
+    playback_clock_t playback_clock;
+    reset_playback_clock(&playback_clock, frame_sync_info.frame_index * frame_timing_sleep);
     unsigned long n_read_items;  // n bytes read from pipe
-    frame_sync_info.uS_elapsed = get_elapsed_time_from_start_us(startTime);
-    while ((n_read_items = fread(frame_data.video_frame, sizeof(char), TOTAL_READ_SIZE, pipein)) || !feof(pipein)) {
-        if (n_read_items < TOTAL_READ_SIZE) {
-            frame_sync_info.uS_elapsed = get_elapsed_time_from_start_us(startTime);
-            sleep_time = frame_timing_sleep - (frame_sync_info.uS_elapsed % frame_timing_sleep);
-            usleep(sleep_time);
-            continue;
+    frame_sync_info.uS_elapsed = get_playback_time_us(&player, &playback_clock);
+    while (!video_stream.eof) {
+        if (interactive_flag) {
+            int was_paused = controls.paused;
+            read_controls(&controls);
+            if (controls.quit)
+                break;
+            if (controls.seek_delta != 0) {
+                clock_gettime(CLOCK_MONOTONIC_COARSE, &seek_start_time);
+                if (user_params.ffmpeg_params.reading_type == SOURCE_MAPPED) {
+                    seek_mapped_stream(&mapped_stream, MAX((double) frame_sync_info.frame_index / VIDEO_FRAMERATE +
+                                                           controls.seek_delta, 0));
+                    frame_sync_info.frame_index = mapped_stream.position;
+                } else if ((return_status = seek_file_source(controls.seek_delta, &user_params.ffmpeg_params,
+                                                             &keyframe_index, &video_stream, &player,
+                                                             frame_data.video_frame, frame_buffer_size,
+                                                             TOTAL_READ_SIZE, &frame_sync_info.frame_index))) {
+                    break;
+                }
+                // the cell cache is keyed by footprint contents, so it stays valid across the jump
+                controls.seek_delta = 0;
+                controls.step = controls.paused;  // show where a paused seek landed
+                if (controls.paused)
+                    pause_player(&player);
+                seek_pending_flag = 1;
+            }
+            if (controls.paused != was_paused) {
+                if (controls.paused) {
+                    pause_player(&player);
+                } else {
+                    resume_player(&player);
+                    reset_playback_clock(&playback_clock, frame_sync_info.frame_index * frame_timing_sleep);
+                }
+            }
+            if (controls.paused && !controls.step) {
+                wait_for_key();
+                continue;
+            }
+        }
+        reset_work_timer(&frame_work);
+        if (!capture &&
+            (return_status = update_terminal_size(&frame_data, &kernel_data, &user_params.terminal_params)))
+            break;
+        if (user_params.ffmpeg_params.reading_type == SOURCE_MAPPED) {
+            frame_params_t mapped_frame_data = frame_data;
+            start_work_timer(&frame_work);  // frames are addressed in the mapping, there is nothing to wait for
+            if (!(mapped_frame_data.video_frame = next_mapped_frame(&mapped_stream)))
+                break;
+            if ((return_status = draw_frame(&mapped_frame_data, &kernel_data, user_params.charset_params,
+                                            user_params.frame_processing_params.edge_threshold,
+                                            user_params.terminal_params.left_border_indent,
+                                            draw_row, &cell_cache)))
+                break;
+            n_read_items = TOTAL_READ_SIZE;
+        } else if (low_latency_flag) {
+            frame_params_t live_frame_data = frame_data;
+            if (!(live_frame_data.video_frame = take_latest_frame(&latest_frame, &video_stream)))
+                break;
+            start_work_timer(&frame_work);
+            if ((return_status = draw_frame(&live_frame_data, &kernel_data, user_params.charset_params,
+                                            user_params.frame_processing_params.edge_threshold,
+                                            user_params.terminal_params.left_border_indent,
+                                            draw_row, &cell_cache)))
+                break;
+            n_read_items = TOTAL_READ_SIZE;
+        } else if (streaming_flag) {
+            if ((return_status = fit_band(&frame_data, &kernel_data, &video_stream, &frame_buffer_size)) ||
+                (return_status = fit_cell_cache(&cell_cache, &frame_data, &kernel_data)))
+                break;
+            n_read_items = stream_frame(&video_stream, &frame_data, &kernel_data, &user_params,
+                                        draw_row, &cell_cache, &frame_work);
+            start_work_timer(&frame_work);
+        } else {
+            n_read_items = read_pipe_stream(&video_stream, frame_data.video_frame, TOTAL_READ_SIZE);
+            start_work_timer(&frame_work);
+            if (n_read_items == TOTAL_READ_SIZE &&
+                (return_status = draw_frame(&frame_data, &kernel_data, user_params.charset_params,
+                                            user_params.frame_processing_params.edge_threshold,
+                                            user_params.terminal_params.left_border_indent,
+                                            draw_row, &cell_cache)))
+                break;
         }
+        if (n_read_items < TOTAL_READ_SIZE)  // reads only come up short once the stream is over
+            break;
         ++frame_sync_info.frame_index;
+        ++n_drawn_frames;
 
-        if ((return_status = update_terminal_size(&frame_data, &kernel_data, &user_params.terminal_params)))
-            break;
-        draw_frame(&frame_data, &kernel_data, user_params.charset_params,
-                   user_params.terminal_params.left_border_indent,
-                   user_params.frame_processing_params.rgb_channels_processor,
-                   symbol_display_method);
+        frame_sync_info.n_reused_cells = cell_cache.n_reused;
+        frame_sync_info.pipe_occupancy = get_pipe_occupancy(&video_stream);
+        frame_sync_info.n_short_reads = video_stream.n_short_reads;
+        if (capture) {
+            write_frame_text(&cell_cache, capture);
+            if (low_latency_flag)
+                record_capture_latency(&capture_log, latest_frame.frame_number, &latency_stats);
+            continue;
+        }
+        frame_sync_info.quality_level = quality_controller.level;
         debug(&frame_sync_info, logs, symbol_display_method);
+        // jumps and single steps are shown right away, pacing restarts from there
+        if (seek_pending_flag || controls.paused) {
+            refresh();
+            if (seek_pending_flag)
+                frame_sync_info.seek_latency_us = get_elapsed_time_from_start_us(seek_start_time);
+            seek_pending_flag = 0;
+            controls.step = 0;
+            reset_playback_clock(&playback_clock, frame_sync_info.frame_index * frame_timing_sleep);
+            frame_sync_info.uS_elapsed = get_playback_time_us(&player, &playback_clock);
+            continue;
+        }
+        stop_work_timer(&frame_work);
+        if (user_params.terminal_params.adaptive_quality_flag &&
+            update_quality(&quality_controller, frame_work.total_us))
+            apply_quality_step(get_quality_step(&quality_controller), &user_params, &kernel_data,
+                               &draw_row, &cell_cache);
+        if (low_latency_flag) {
+            // no pacing: the next frame is drawn as soon as it arrives
+            refresh();
+            record_capture_latency(&capture_log, latest_frame.frame_number, &latency_stats);
+            frame_sync_info.capture_latency_us = latency_stats.last_latency_us;
+            frame_sync_info.uS_elapsed = get_playback_time_us(&player, &playback_clock);
+            frame_sync_info.time_frame_index = frame_sync_info.frame_index;
+            continue;
+        }
         // ASCII frame drawing
         prev_uS_elapsed = frame_sync_info.uS_elapsed;
-        frame_sync_info.uS_elapsed = get_elapsed_time_from_start_us(startTime);
-        frame_sync_info.cur_frame_processing_time = frame_sync_info.uS_elapsed - prev_uS_elapsed;
+        frame_sync_info.uS_elapsed = get_playback_time_us(&player, &playback_clock);
+        // the player clock may step back slightly between reports
+        frame_sync_info.cur_frame_processing_time = (frame_sync_info.uS_elapsed > prev_uS_elapsed)
+                ? frame_sync_info.uS_elapsed - prev_uS_elapsed
+                : 0;
 
         sleep_time = frame_timing_sleep - (frame_sync_info.uS_elapsed % frame_timing_sleep);
         usleep(sleep_time);
@@ -139,17 +648,47 @@ int main(int argc, char *argv[]) {
                 : frame_sync_info.frame_index - frame_sync_info.time_frame_index;
 
         if (user_params.ffmpeg_params.reading_type == SOURCE_FILE && frame_sync_info.time_frame_index > frame_sync_info.frame_index) {
-            for (size_t i=0; i<frame_sync_info.frame_desync; ++i)
-                fread(frame_data.video_frame, sizeof(char), TOTAL_READ_SIZE, pipein);
+            skip_bytes(&video_stream, frame_data.video_frame, frame_buffer_size,
+                       frame_sync_info.frame_desync * TOTAL_READ_SIZE);
+            frame_sync_info.frame_index = frame_sync_info.time_frame_index;
+        } else if (user_params.ffmpeg_params.reading_type == SOURCE_MAPPED &&
+                   frame_sync_info.time_frame_index > frame_sync_info.frame_index) {
+            skip_mapped_frames(&mapped_stream, frame_sync_info.frame_desync);  // nothing to read through
             frame_sync_info.frame_index = frame_sync_info.time_frame_index;
         } else if (frame_sync_info.time_frame_index < frame_sync_info.frame_index) {
             usleep((frame_sync_info.frame_index - frame_sync_info.time_frame_index) * frame_timing_sleep);
         }
     }
     free_memory:
-        getchar();
-        endwin();
-        printf("END\n");
-        free_space(frame_data.video_frame, pipein, logs);
+        if (capture) {
+            uint64_t summary_us = get_precise_elapsed_time_us(summary_start);
+            fprintf(stderr, "frames: %zu, elapsed: %.3f s, fps: %.2f\n",
+                    n_drawn_frames,
+                    (double) summary_us / N_uSECONDS_IN_ONE_SEC,
+                    summary_us ? n_drawn_frames * (double) N_uSECONDS_IN_ONE_SEC / summary_us : 0.0);
+            fclose(capture);
+        } else {
+            if (!controls.quit)
+                getchar();
+            endwin();
+            printf("END\n");
+        }
+        if (low_latency_flag) {
+            // the log lines of the last frames may still be on the way
+            resolve_capture_latencies(&capture_log, &latency_stats);
+            fprintf(stderr, "capture latency: avg %.1f ms, max %.1f ms, unknown: %zu, dropped frames: %zu\n",
+                    latency_stats.n_samples ? latency_stats.total_us / 1000.0 / latency_stats.n_samples : 0.0,
+                    latency_stats.max_us / 1000.0,
+                    latency_stats.n_unknown + latency_stats.n_pending,
+                    latest_frame.n_dropped);
+        }
+        stop_player(&player);
+        free_cell_cache(&cell_cache);
+        free_resample_cache();
+        close_mapped_stream(&mapped_stream);
+        free_keyframe_index(&keyframe_index);
+        close_latest_frame(&latest_frame);
+        close_capture_log(&capture_log);
+        free_space(frame_data.video_frame, &video_stream, logs);
     return return_status;
 }
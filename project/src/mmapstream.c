@@ -0,0 +1,273 @@
+#define _GNU_SOURCE  // madvise
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mmapstream.h"
+#include "pipestream.h"
+#include "videostream.h"
+#include "status_codes.h"
+#include "utils.h"
+
+#define Y4M_MAGIC "YUV4MPEG2"
+#define Y4M_FRAME_MAGIC "FRAME"
+#define MAPPED_READAHEAD_SIZE (64 << 20)  // bytes advised ahead of the playback position
+
+static const char *raw_extensions[] = {".rgb", ".rgb24", ".raw"};
+
+static int has_extension(const char *file_path, const char *extension) {
+    size_t path_length = strlen(file_path), extension_length = strlen(extension);
+    return path_length > extension_length &&
+           !strcasecmp(file_path + path_length - extension_length, extension);
+}
+
+static int is_raw_source(const char *file_path) {
+    for (size_t i = 0; i < sizeof(raw_extensions) / sizeof(raw_extensions[0]); ++i)
+        if (has_extension(file_path, raw_extensions[i]))
+            return 1;
+    return 0;
+}
+
+int is_mapped_source(const char *file_path) {
+    return is_raw_source(file_path) || has_extension(file_path, ".y4m");
+}
+
+void init_mapped_stream(mapped_stream_t *stream) {
+    stream->mapping = NULL;
+    stream->mapping_size = 0;
+    stream->rgb_frame = NULL;
+    stream->n_frames = 0;
+    stream->position = 0;
+    stream->readahead_end = 0;
+}
+
+// parses "YUV4MPEG2 W<w> H<h> F<n>:<d> C<colorspace> ...\n" and the first frame header
+static int parse_y4m_header(mapped_stream_t *stream) {
+    const char *header = (const char *) stream->mapping;
+    const char *header_end = memchr(header, '\n', stream->mapping_size);
+    if (stream->mapping_size < sizeof(Y4M_MAGIC) || memcmp(header, Y4M_MAGIC, strlen(Y4M_MAGIC)) || !header_end) {
+        fprintf(stderr, "Invalid y4m header!\n");
+        return MAPPING_ERROR;
+    }
+
+    stream->width = stream->height = 0;
+    stream->format = MAPPED_Y4M_420;  // the format's default colorspace
+    for (const char *token = header + strlen(Y4M_MAGIC); token < header_end; ++token) {
+        if (token[-1] != ' ')
+            continue;
+        if (*token == 'W') {
+            stream->width = atoi(token + 1);
+        } else if (*token == 'H') {
+            stream->height = atoi(token + 1);
+        } else if (*token == 'F') {
+            char *separator;
+            double numerator = strtod(token + 1, &separator);
+            double denominator = (*separator == ':') ? strtod(separator + 1, NULL) : 0;
+            if (numerator > 0 && denominator > 0)
+                stream->frame_rate = numerator / denominator;
+        } else if (*token == 'C') {
+            size_t colorspace_length = strcspn(token + 1, " \n");
+            if (!strncmp(token + 1, "420", 3) &&  // chroma siting variants only differ in filtering
+                (colorspace_length == 3 || !strncmp(token + 4, "jpeg", 4) ||
+                 !strncmp(token + 4, "mpeg2", 5) || !strncmp(token + 4, "paldv", 5))) {
+                stream->format = MAPPED_Y4M_420;
+            } else if (colorspace_length == 3 && !strncmp(token + 1, "444", 3)) {
+                stream->format = MAPPED_Y4M_444;
+            } else if (colorspace_length == 4 && !strncmp(token + 1, "mono", 4)) {
+                stream->format = MAPPED_Y4M_MONO;
+            } else {  // 4:2:2, alpha and high bit depth variants
+                fprintf(stderr, "Unsupported y4m colorspace: C%.*s\n", (int) colorspace_length, token + 1);
+                return NOT_IMPLEMENTED_ERROR;
+            }
+        }
+    }
+    if (stream->width <= 0 || stream->height <= 0) {
+        fprintf(stderr, "Invalid y4m header! Width/height not found\n");
+        return RESOLUTION_OBTAINING_ERROR;
+    }
+
+    size_t luma_size = (size_t) stream->width * stream->height;
+    size_t chroma_size = (size_t) ((stream->width + 1) / 2) * ((stream->height + 1) / 2);
+    size_t frame_size = (stream->format == MAPPED_Y4M_420) ? luma_size + 2 * chroma_size
+                      : (stream->format == MAPPED_Y4M_444) ? 3 * luma_size
+                      : luma_size;
+
+    // frame headers may carry parameters, but a file written by one muxer keeps them constant
+    const char *frame_header = header_end + 1;
+    size_t n_left = stream->mapping_size - (frame_header - header);
+    const char *frame_header_end = memchr(frame_header, '\n', n_left);
+    if (!frame_header_end || memcmp(frame_header, Y4M_FRAME_MAGIC, strlen(Y4M_FRAME_MAGIC))) {
+        fprintf(stderr, "Invalid y4m file! No frames found\n");
+        return MAPPING_ERROR;
+    }
+    stream->frame_header_size = frame_header_end + 1 - frame_header;
+    stream->first_frame_offset = (frame_header_end + 1) - header;
+    stream->frame_stride = stream->frame_header_size + frame_size;
+    stream->n_frames = n_left / stream->frame_stride;
+
+    if (!(stream->rgb_frame = alloc_frame_slot((size_t) stream->width * stream->height * 3))) {
+        fprintf(stderr, "Couldn't allocate memory for frame!");
+        return FRAME_ALLOCATION_ERROR;
+    }
+    return SUCCESS;
+}
+
+int open_mapped_stream(mapped_stream_t *stream, const char *file_path,
+                       int width, int height, int n_stream_loops) {
+    init_mapped_stream(stream);
+    stream->n_stream_loops = n_stream_loops;
+    stream->frame_rate = VIDEO_FRAMERATE;
+
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Couldn't open %s!\n", file_path);
+        return FOPEN_ERROR;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || !file_stat.st_size) {
+        fprintf(stderr, "Couldn't get size of %s!\n", file_path);
+        close(fd);
+        return FOPEN_ERROR;
+    }
+    stream->mapping_size = file_stat.st_size;
+    void *mapping = mmap(NULL, stream->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // the mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Couldn't map %s into memory!\n", file_path);
+        return MAPPING_ERROR;
+    }
+    stream->mapping = mapping;
+    // the kernel reads ahead harder and drops pages behind us; the window below does the rest
+    madvise(stream->mapping, stream->mapping_size, MADV_SEQUENTIAL);
+
+    int return_status;
+    if (is_raw_source(file_path)) {
+        // raw rgb24 frames carry no header: they are expected at VIDEO_FRAMERATE, size given by the user
+        if (width <= 0 || height <= 0) {
+            fprintf(stderr, "Frame size of raw rgb24 file is not given! Use -size WxH\n");
+            close_mapped_stream(stream);
+            return FLAG_ERROR;
+        }
+        stream->format = MAPPED_RGB24;
+        stream->width = width;
+        stream->height = height;
+        stream->first_frame_offset = 0;
+        stream->frame_header_size = 0;
+        stream->frame_stride = (size_t) width * height * 3;
+        stream->n_frames = stream->mapping_size / stream->frame_stride;
+    } else if ((return_status = parse_y4m_header(stream))) {
+        close_mapped_stream(stream);
+        return return_status;
+    }
+    if (!stream->n_frames) {
+        fprintf(stderr, "%s doesn't hold a single complete frame!\n", file_path);
+        close_mapped_stream(stream);
+        return MAPPING_ERROR;
+    }
+    return SUCCESS;
+}
+
+void seek_mapped_stream(mapped_stream_t *stream, double seconds) {
+    stream->position = (seconds > 0) ? (size_t) (seconds * VIDEO_FRAMERATE + 0.5) : 0;
+}
+
+void skip_mapped_frames(mapped_stream_t *stream, size_t n_frames) {
+    stream->position += n_frames;
+}
+
+static void advise_frames(const mapped_stream_t *stream, size_t first_frame, size_t last_frame) {
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t begin = stream->first_frame_offset + first_frame * stream->frame_stride;
+    size_t end = MIN(stream->first_frame_offset + last_frame * stream->frame_stride, stream->mapping_size);
+    begin -= begin % page_size;
+    madvise(stream->mapping + begin, end - begin, MADV_WILLNEED);
+}
+
+// keeps the pages of the next MAPPED_READAHEAD_SIZE bytes on their way in; after a seek or
+// a loop the window simply restarts at the new position
+static void update_readahead(mapped_stream_t *stream, size_t frame_index) {
+    size_t window = MAX(MAPPED_READAHEAD_SIZE / stream->frame_stride, 2);
+    if (frame_index > stream->readahead_end || frame_index + window < stream->readahead_end)
+        stream->readahead_end = frame_index;
+    // advise in half windows so this costs a syscall every few frames, not every frame
+    if (stream->readahead_end > frame_index + window / 2)
+        return;
+    size_t new_end = MIN(frame_index + window, stream->n_frames);
+    advise_frames(stream, stream->readahead_end, new_end);
+    stream->readahead_end = new_end;
+    // another loop follows: its first frames are needed right after the last one
+    if (frame_index + window > stream->n_frames && stream->n_stream_loops)
+        advise_frames(stream, 0, MIN(frame_index + window - stream->n_frames, stream->n_frames));
+}
+
+static inline unsigned char clamp_channel(int value) {
+    return (unsigned char) (value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+// BT.601 limited range, the matrix ffmpeg uses when writing y4m from rgb
+static void yuv_to_rgb(const mapped_stream_t *stream, const unsigned char *frame) {
+    const unsigned char *y_plane = frame;
+    const unsigned char *u_plane = y_plane + (size_t) stream->width * stream->height;
+    size_t chroma_width = stream->width, chroma_size = (size_t) stream->width * stream->height;
+    int chroma_shift = 0;
+    if (stream->format == MAPPED_Y4M_420) {
+        chroma_width = (stream->width + 1) / 2;
+        chroma_size = chroma_width * ((stream->height + 1) / 2);
+        chroma_shift = 1;
+    }
+    const unsigned char *v_plane = u_plane + chroma_size;
+
+    unsigned char *rgb = stream->rgb_frame;
+    for (int row = 0; row < stream->height; ++row) {
+        const unsigned char *y_row = y_plane + (size_t) row * stream->width;
+        const unsigned char *u_row = u_plane + (size_t) (row >> chroma_shift) * chroma_width;
+        const unsigned char *v_row = v_plane + (size_t) (row >> chroma_shift) * chroma_width;
+        for (int col = 0; col < stream->width; ++col, rgb += 3) {
+            int c = 298 * (y_row[col] - 16) + 128;
+            if (stream->format == MAPPED_Y4M_MONO) {
+                rgb[0] = rgb[1] = rgb[2] = clamp_channel(c >> 8);
+                continue;
+            }
+            int d = u_row[col >> chroma_shift] - 128;
+            int e = v_row[col >> chroma_shift] - 128;
+            rgb[0] = clamp_channel((c + 409 * e) >> 8);
+            rgb[1] = clamp_channel((c - 100 * d - 208 * e) >> 8);
+            rgb[2] = clamp_channel((c + 516 * d) >> 8);
+        }
+    }
+}
+
+unsigned char *next_mapped_frame(mapped_stream_t *stream) {
+    // output frames are taken at VIDEO_FRAMERATE, like ffmpeg's fps filter does for piped sources
+    size_t source_index = (size_t) ((double) stream->position * stream->frame_rate / VIDEO_FRAMERATE);
+    size_t n_loop = source_index / stream->n_frames;
+    if (stream->n_stream_loops >= 0 && n_loop > (size_t) stream->n_stream_loops)
+        return NULL;
+    ++stream->position;
+
+    size_t frame_index = source_index % stream->n_frames;
+    update_readahead(stream, frame_index);
+    unsigned char *frame = stream->mapping + stream->first_frame_offset + frame_index * stream->frame_stride;
+    if (stream->format == MAPPED_RGB24)
+        return frame;
+
+    if (memcmp(frame - stream->frame_header_size, Y4M_FRAME_MAGIC, strlen(Y4M_FRAME_MAGIC))) {
+        fprintf(stderr, "Invalid y4m frame header at frame %zu!\n", frame_index);
+        return NULL;
+    }
+    yuv_to_rgb(stream, frame);
+    return stream->rgb_frame;
+}
+
+void close_mapped_stream(mapped_stream_t *stream) {
+    if (stream->mapping)
+        munmap(stream->mapping, stream->mapping_size);
+    free(stream->rgb_frame);
+    init_mapped_stream(stream);
+}
@@ -0,0 +1,176 @@
+#define _GNU_SOURCE  // F_SETPIPE_SZ
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "pipestream.h"
+#include "status_codes.h"
+#include "utils.h"
+
+#define PIPE_MAX_SIZE_PATH "/proc/sys/fs/pipe-max-size"
+
+static long get_page_size() {
+    long page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? page_size : 4096;
+}
+
+static int get_pipe_max_size() {
+    int pipe_max_size = -1;
+    FILE *limit_file = fopen(PIPE_MAX_SIZE_PATH, "r");
+    if (limit_file) {
+        if (fscanf(limit_file, "%d", &pipe_max_size) != 1)
+            pipe_max_size = -1;
+        fclose(limit_file);
+    }
+    return pipe_max_size;
+}
+
+void init_pipe_stream(pipe_stream_t *stream) {
+    stream->pipeline = NULL;
+    stream->fd = -1;
+    stream->pipe_size = 0;
+    stream->n_reads = 0;
+    stream->n_short_reads = 0;
+    stream->eof = 0;
+}
+
+int open_pipe_stream(pipe_stream_t *stream, FILE *pipeline, size_t read_size) {
+    init_pipe_stream(stream);
+    stream->pipeline = pipeline;
+    stream->fd = fileno(pipeline);
+    if (stream->fd < 0) {
+        fprintf(stderr, "Couldn't get pipe descriptor!");
+        return POPEN_ERROR;
+    }
+    // popen doesn't set it: a player forked later would keep the pipe open and pclose would hang
+    fcntl(stream->fd, F_SETFD, FD_CLOEXEC);
+    resize_pipe_stream(stream, read_size);
+    return SUCCESS;
+}
+
+void resize_pipe_stream(pipe_stream_t *stream, size_t read_size) {
+    // one read should fit into the pipe so the decoder never waits on us mid-read;
+    // an unprivileged process is capped by pipe-max-size, so failures here aren't fatal
+    long page_size = get_page_size();
+    size_t wanted_size = (read_size + page_size - 1) / page_size * page_size;
+    int pipe_max_size = get_pipe_max_size();
+    if (pipe_max_size > 0)
+        wanted_size = MIN(wanted_size, (size_t) pipe_max_size);
+    fcntl(stream->fd, F_SETPIPE_SZ, (int) wanted_size);
+    stream->pipe_size = fcntl(stream->fd, F_GETPIPE_SZ);
+}
+
+size_t read_pipe_stream(pipe_stream_t *stream, unsigned char *buffer, size_t n_bytes) {
+    size_t n_read_total = 0;
+    while (n_read_total < n_bytes) {
+        ssize_t n_read = read(stream->fd, buffer + n_read_total, n_bytes - n_read_total);
+        ++stream->n_reads;
+        if (n_read < 0) {
+            if (errno == EINTR)
+                continue;
+            stream->eof = 1;
+            break;
+        } else if (!n_read) {
+            stream->eof = 1;
+            break;
+        }
+        // the rest is already on its way: block in read() again instead of sleeping
+        if ((size_t) n_read < n_bytes - n_read_total)
+            ++stream->n_short_reads;
+        n_read_total += n_read;
+    }
+    return n_read_total;
+}
+
+int get_pipe_occupancy(const pipe_stream_t *stream) {
+    int n_pending;
+    if (ioctl(stream->fd, FIONREAD, &n_pending))
+        return -1;
+    return n_pending;
+}
+
+void close_pipe_stream(pipe_stream_t *stream) {
+    if (stream->pipeline)
+        pclose(stream->pipeline);
+    stream->pipeline = NULL;
+    stream->fd = -1;
+}
+
+unsigned char *alloc_frame_slot(size_t size) {
+    void *slot = NULL;
+    if (posix_memalign(&slot, get_page_size(), size))
+        return NULL;
+    return slot;
+}
+
+void init_latest_frame(latest_frame_t *latest) {
+    latest->slots[0] = NULL;
+    latest->slots[1] = NULL;
+    latest->frame_size = 0;
+    latest->fill = 0;
+    latest->has_frame = 0;
+    latest->n_frames = 0;
+    latest->n_dropped = 0;
+    latest->frame_number = 0;
+}
+
+int open_latest_frame(latest_frame_t *latest, size_t frame_size) {
+    init_latest_frame(latest);
+    latest->slots[0] = alloc_frame_slot(frame_size);
+    latest->slots[1] = alloc_frame_slot(frame_size);
+    if (!latest->slots[0] || !latest->slots[1]) {
+        fprintf(stderr, "Couldn't allocate memory for frame!");
+        close_latest_frame(latest);
+        return FRAME_ALLOCATION_ERROR;
+    }
+    latest->frame_size = frame_size;
+    return SUCCESS;
+}
+
+unsigned char *take_latest_frame(latest_frame_t *latest, pipe_stream_t *stream) {
+    while (!stream->eof) {
+        // block only while there is nothing to hand out; otherwise take just what is already there
+        struct pollfd pipe_poll = {stream->fd, POLLIN, 0};
+        int n_ready = poll(&pipe_poll, 1, latest->has_frame ? 0 : -1);
+        if (n_ready < 0 && errno == EINTR)
+            continue;
+        if (!n_ready)
+            break;
+
+        ssize_t n_read = (n_ready < 0) ? -1 : read(stream->fd, latest->slots[1] + latest->fill,
+                                                   latest->frame_size - latest->fill);
+        ++stream->n_reads;
+        if (n_read < 0 && errno == EINTR)
+            continue;
+        if (n_read <= 0) {
+            stream->eof = 1;
+            break;
+        }
+        latest->fill += n_read;
+        if (latest->fill < latest->frame_size)
+            continue;
+
+        unsigned char *complete = latest->slots[1];
+        latest->slots[1] = latest->slots[0];
+        latest->slots[0] = complete;
+        latest->fill = 0;
+        latest->n_dropped += latest->has_frame;
+        latest->has_frame = 1;
+        ++latest->n_frames;
+    }
+    if (!latest->has_frame)
+        return NULL;
+    latest->has_frame = 0;
+    latest->frame_number = latest->n_frames - 1;
+    return latest->slots[0];
+}
+
+void close_latest_frame(latest_frame_t *latest) {
+    free(latest->slots[0]);
+    free(latest->slots[1]);
+    init_latest_frame(latest);
+}
@@ -0,0 +1,74 @@
+#include "quality.h"
+
+#define QUALITY_AVG_WEIGHT 0.1       // weight of the newest frame in the moving average
+#define QUALITY_DEGRADE_RATIO 0.9    // of the frame budget
+#define QUALITY_UPGRADE_RATIO 0.5
+#define QUALITY_DEGRADE_FRAMES 10    // hysteresis: stepping down reacts within a fraction of a second,
+#define QUALITY_UPGRADE_FRAMES 75    // stepping back up needs a few calm seconds
+#define QUALITY_COARSE_SCALE 75
+#define QUALITY_COARSEST_SCALE 50
+
+void init_quality_controller(quality_controller_t *controller,
+                             kernel_update_method update_kernel,
+                             output_t output,
+                             size_t frame_budget_us) {
+    quality_step_t step = {update_kernel, output, 100};
+    controller->n_steps = 0;
+    controller->steps[controller->n_steps++] = step;
+    // only rungs that actually change something are added;
+    // area costs about as much as naive and switching would change the grid
+    if (step.update_kernel != update_naive && step.update_kernel != update_area) {
+        step.update_kernel = update_naive;
+        controller->steps[controller->n_steps++] = step;
+    }
+    if (step.output == OUTPUT_COLORED) {
+        step.output = OUTPUT_SIMPLE;
+        controller->steps[controller->n_steps++] = step;
+    }
+    step.grid_scale = QUALITY_COARSE_SCALE;
+    controller->steps[controller->n_steps++] = step;
+    step.grid_scale = QUALITY_COARSEST_SCALE;
+    controller->steps[controller->n_steps++] = step;
+
+    controller->level = 0;
+    controller->frame_budget_us = frame_budget_us;
+    controller->avg_frame_time_us = 0;
+    controller->n_over_budget = 0;
+    controller->n_under_budget = 0;
+}
+
+int update_quality(quality_controller_t *controller, size_t frame_time_us) {
+    controller->avg_frame_time_us += QUALITY_AVG_WEIGHT * ((double) frame_time_us - controller->avg_frame_time_us);
+
+    if (controller->avg_frame_time_us > QUALITY_DEGRADE_RATIO * controller->frame_budget_us) {
+        // counted in frame slots: a frame that took several budgets (and made us drop frames)
+        // is as much evidence as several slightly late ones
+        controller->n_over_budget += 1 + (int) (frame_time_us / controller->frame_budget_us);
+        controller->n_under_budget = 0;
+    } else if (controller->avg_frame_time_us < QUALITY_UPGRADE_RATIO * controller->frame_budget_us) {
+        ++controller->n_under_budget;
+        controller->n_over_budget = 0;
+    } else {
+        controller->n_over_budget = 0;
+        controller->n_under_budget = 0;
+    }
+
+    int new_level = controller->level;
+    if (controller->n_over_budget >= QUALITY_DEGRADE_FRAMES && controller->level < controller->n_steps - 1)
+        ++new_level;
+    else if (controller->n_under_budget >= QUALITY_UPGRADE_FRAMES && controller->level > 0)
+        --new_level;
+    if (new_level == controller->level)
+        return 0;
+
+    // the average still describes the previous level: start collecting evidence anew
+    controller->level = new_level;
+    controller->avg_frame_time_us = (QUALITY_DEGRADE_RATIO + QUALITY_UPGRADE_RATIO) / 2 * controller->frame_budget_us;
+    controller->n_over_budget = 0;
+    controller->n_under_budget = 0;
+    return 1;
+}
+
+const quality_step_t *get_quality_step(const quality_controller_t *controller) {
+    return &controller->steps[controller->level];
+}
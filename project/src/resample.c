@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "resample.h"
+#include "utils.h"
+
+#define RESAMPLE_CACHE_SIZE 8  // axes of a few recent grid sizes
+
+static resample_axis_t axis_cache[RESAMPLE_CACHE_SIZE];
+static unsigned long axis_last_use[RESAMPLE_CACHE_SIZE];
+static unsigned long n_axis_uses = 0;
+
+static void free_axis(resample_axis_t *axis) {
+    free(axis->starts);
+    free(axis->lengths);
+    free(axis->offsets);
+    free(axis->weights);
+    free(axis->weight_sums);
+    axis->starts = NULL;
+    axis->lengths = NULL;
+    axis->offsets = NULL;
+    axis->weights = NULL;
+    axis->weight_sums = NULL;
+    axis->source_length = 0;
+    axis->grid_length = 0;
+}
+
+static int build_axis(resample_axis_t *axis, int source_length, int grid_length) {
+    axis->starts = malloc(sizeof(int) * grid_length);
+    axis->lengths = malloc(sizeof(int) * grid_length);
+    axis->offsets = malloc(sizeof(int) * grid_length);
+    // a cell touches at most one pixel more than it covers: source_length + grid_length in total
+    axis->weights = malloc(sizeof(uint16_t) * (source_length + grid_length));
+    axis->weight_sums = malloc(sizeof(uint32_t) * grid_length);
+    if (!axis->starts || !axis->lengths || !axis->offsets || !axis->weights || !axis->weight_sums) {
+        free_axis(axis);
+        return 1;
+    }
+
+    // positions are counted in 1 / grid_length of a source pixel, so every border is an integer
+    int n_weights = 0;
+    axis->max_length = 0;
+    for (int cell = 0; cell < grid_length; ++cell) {
+        long long begin = (long long) cell * source_length;
+        long long end = begin + source_length;
+        int first = (int) (begin / grid_length);
+        int last = (int) ((end - 1) / grid_length);
+
+        axis->starts[cell] = first;
+        axis->offsets[cell] = n_weights;
+        axis->weight_sums[cell] = 0;
+        for (int pixel = first; pixel <= last; ++pixel) {
+            long long covered = MIN(end, (long long) (pixel + 1) * grid_length) -
+                                MAX(begin, (long long) pixel * grid_length);
+            uint16_t weight = (uint16_t) ((covered * AREA_WEIGHT_ONE + grid_length / 2) / grid_length);
+            if (!weight) {
+                // a barely touched border pixel: leave it out of the footprint entirely
+                if (first != last) {
+                    if (pixel == first)
+                        ++axis->starts[cell];
+                    continue;
+                }
+                weight = 1;
+            }
+            axis->weights[n_weights++] = weight;
+            axis->weight_sums[cell] += weight;
+        }
+        axis->lengths[cell] = n_weights - axis->offsets[cell];
+        axis->max_length = MAX(axis->max_length, axis->lengths[cell]);
+    }
+    axis->source_length = source_length;
+    axis->grid_length = grid_length;
+    return 0;
+}
+
+const resample_axis_t *get_resample_axis(int source_length, int grid_length) {
+    int victim = 0;
+    for (int i = 0; i < RESAMPLE_CACHE_SIZE; ++i) {
+        if (axis_cache[i].starts && axis_cache[i].source_length == source_length &&
+            axis_cache[i].grid_length == grid_length) {
+            axis_last_use[i] = ++n_axis_uses;
+            return &axis_cache[i];
+        }
+        if (axis_last_use[i] < axis_last_use[victim])
+            victim = i;
+    }
+
+    // the least recently used axis is never one the current grid still points to:
+    // both axes of a grid are fetched right after each other
+    free_axis(&axis_cache[victim]);
+    if (build_axis(&axis_cache[victim], source_length, grid_length)) {
+        fprintf(stderr, "Couldn't allocate resampling tables!");
+        axis_last_use[victim] = 0;
+        return NULL;
+    }
+    axis_last_use[victim] = ++n_axis_uses;
+    return &axis_cache[victim];
+}
+
+void free_resample_cache() {
+    for (int i = 0; i < RESAMPLE_CACHE_SIZE; ++i) {
+        free_axis(&axis_cache[i]);
+        axis_last_use[i] = 0;
+    }
+}
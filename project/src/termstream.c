@@ -8,6 +8,7 @@
 #include "status_codes.h"
 
 #include <ncurses.h>
+#include <math.h>
 
 #define RED_DEPTH 6
 #define GREEN_DEPTH 7
@@ -29,11 +30,79 @@ static char get_char_given_intensity(unsigned char intensity,
     return char_set[max_index - intensity * max_index / 255];
 }
 
+int update_grid_size(frame_params_t *frame_params,
+                     kernel_params_t *kernel_params,
+                     terminal_params_t *terminal_params,
+                     int n_rows,
+                     int n_cols) {
+    int terminal_n_cols = n_cols;  // the grid is centered in the whole terminal
+    n_rows = MAX(n_rows * terminal_params->grid_scale / 100, 1);
+    n_cols = MAX(n_cols * terminal_params->grid_scale / 100, 1);
+    int rectified_height = MIN(n_rows, terminal_params->max_height);
+    int rectified_width = MIN(n_cols, terminal_params->max_width);
+
+    if (terminal_params->preserve_aspect_flag) {
+        if (frame_params->aspect_ratio) {  // width > height
+            int new_rectified_height = frame_params->height * rectified_width / frame_params->width;
+            if (new_rectified_height > n_rows) {
+                rectified_width = frame_params->width * rectified_height / frame_params->height;
+            } else {
+                rectified_height = new_rectified_height;
+            }
+        } else {  // height > width
+            int new_rectified_width = frame_params->width * rectified_height / frame_params->height;
+            if (new_rectified_width > n_cols) {
+                rectified_height = frame_params->height * rectified_width / frame_params->width;
+            } else {
+                rectified_width = new_rectified_width;
+            }
+        }
+    }
+    if (kernel_params->update_kernel == update_area) {
+        // fractional footprints: the grid is exactly rectified_height x rectified_width
+        kernel_params->row_axis = get_resample_axis(frame_params->height, rectified_height);
+        kernel_params->col_axis = get_resample_axis(frame_params->width, rectified_width);
+        if (!kernel_params->row_axis || !kernel_params->col_axis)
+            return KERNEL_UPDATE_ERROR;
+        kernel_params->width = kernel_params->row_axis->max_length;
+        kernel_params->height = kernel_params->col_axis->max_length;
+    } else {
+        kernel_params->row_axis = NULL;
+        kernel_params->col_axis = NULL;
+        kernel_params->width = MAX((frame_params->height + rectified_height) / rectified_height, 1);
+        kernel_params->height = MAX((frame_params->width + rectified_width) / rectified_width, 1);
+    }
+    kernel_params->volume = kernel_params->width * kernel_params->height * 3;
+    int kernel_update_status = kernel_params->update_kernel(&kernel_params->kernel,
+                                                            kernel_params->width,
+                                                            kernel_params->height);
+
+    int grid_width;
+    if (kernel_params->col_axis) {
+        // nothing is trimmed: the border cells take the remainder
+        frame_params->trimmed_height = frame_params->height;
+        frame_params->trimmed_width = frame_params->width;
+        grid_width = kernel_params->col_axis->grid_length;
+    } else {
+        frame_params->trimmed_height = frame_params->height - frame_params->height % kernel_params->width;
+        frame_params->trimmed_width = frame_params->width - frame_params->width % kernel_params->height;
+        grid_width = frame_params->trimmed_width / kernel_params->height;
+    }
+    terminal_params->left_border_indent = MAX(0, (terminal_n_cols - grid_width) / 2);
+    return kernel_update_status;
+}
+
+// current terminal size in rows and cols
+static int n_rows = -1, n_cols = -1;
+
+void force_terminal_update() {
+    n_rows = -1;
+    n_cols = -1;
+}
+
 int update_terminal_size(frame_params_t *frame_params,
                           kernel_params_t *kernel_params,
                           terminal_params_t *terminal_params) {
-    // current terminal size in rows and cols
-    static int n_rows = -1, n_cols = -1;
     int new_n_rows, new_n_cols;
     int kernel_update_status = SUCCESS;
 
@@ -42,37 +111,7 @@ int update_terminal_size(frame_params_t *frame_params,
     if (n_rows != new_n_rows || n_cols != new_n_cols) {
         n_rows = new_n_rows;
         n_cols = new_n_cols;
-
-        int rectified_height = MIN(new_n_rows, terminal_params->max_height);
-        int rectified_width = MIN(new_n_cols, terminal_params->max_width);
-
-        if (terminal_params->preserve_aspect_flag) {
-            if (frame_params->aspect_ratio) {  // width > height
-                int new_rectified_height = frame_params->height * rectified_width / frame_params->width;
-                if (new_rectified_height > n_rows) {
-                    rectified_width = frame_params->width * rectified_height / frame_params->height;
-                } else {
-                    rectified_height = new_rectified_height;
-                }
-            } else {  // height > width
-                int new_rectified_width = frame_params->width * rectified_height / frame_params->height;
-                if (new_rectified_width > n_cols) {
-                    rectified_height = frame_params->height * rectified_width / frame_params->width;
-                } else {
-                    rectified_width = new_rectified_width;
-                }
-            }
-        }
-        kernel_params->width = MAX((frame_params->height + rectified_height) / rectified_height, 1);
-        kernel_params->height = MAX((frame_params->width + rectified_width) / rectified_width, 1);
-        kernel_params->volume = kernel_params->width * kernel_params->height * 3;
-        kernel_update_status = kernel_params->update_kernel(&kernel_params->kernel,
-                                                            kernel_params->width,
-                                                            kernel_params->height);
-
-        frame_params->trimmed_height = frame_params->height - frame_params->height % kernel_params->width;
-        frame_params->trimmed_width = frame_params->width - frame_params->width % kernel_params->height;
-        terminal_params->left_border_indent = MAX(0, (n_cols - frame_params->trimmed_width / kernel_params->height) / 2);
+        kernel_update_status = update_grid_size(frame_params, kernel_params, terminal_params, n_rows, n_cols);
         clear();
     }
     return kernel_update_status;
@@ -96,14 +135,24 @@ void debug(const sync_info_t *debug_info,
     // Cur uSPF - micro (u) Seconds Per Frame (current);
     // Avg uSPF - micro (u) Seconds Per Frame (Avg);
     // FPS      - Frames Per Second;
+    // Reused   - cells taken from the cache (footprint didn't change);
+    // Q        - quality level (0 - as configured, higher - degraded under load);
+    // Pipe     - bytes waiting in the decoder pipe;
+    // Short    - total number of reads that returned less than requested;
+    // Seek     - microseconds from the last seek keypress to the first frame drawn at the new position;
+    // Lat      - microseconds from capture to display of the latest frame with a known capture time
+    //            (--low-latency camera), "unknown" before the first one;
     int n_rows, n_cols;
     getmaxyx(stdscr, n_rows, n_cols);
+    char capture_latency[24] = "unknown";
+    if (debug_info->capture_latency_us != CAPTURE_LATENCY_UNKNOWN)
+        snprintf(capture_latency, sizeof(capture_latency), "%zu", debug_info->capture_latency_us);
     size_t uS_per_frame  = debug_info->uS_elapsed / debug_info->frame_index +
             (debug_info->uS_elapsed % debug_info->frame_index != 0);
     // "EL uS:%10llu|EL S:%8.2f|FI:%5llu|TFI:%5llu|TFI - FI:%2d|uSPF:%8llu|Cur uSPF:%8llu|Avg uSPF:%8llu|FPS:%8f"
     snprintf(command_buffer, COMMAND_BUFFER_SIZE,
              "\nEL uS:%10zu|EL S:%8.2f|FI:%5zu|TFI:%5zu|abs(TFI - FI):%2zu|"
-             "uSPF:%8d|Cur uSPF:%8zu|Avg uSPF:%8zu|FPS:%8Lf|t_size:%2dx%2d\n",
+             "uSPF:%8d|Cur uSPF:%8zu|Avg uSPF:%8zu|FPS:%8Lf|Reused:%6zu|Q:%d|Pipe:%8d|Short:%6zu|Seek:%7zu|Lat:%7s|t_size:%2dx%2d\n",
              debug_info->uS_elapsed,
              (double) debug_info->uS_elapsed / N_uSECONDS_IN_ONE_SEC,
              debug_info->frame_index,
@@ -113,6 +162,12 @@ void debug(const sync_info_t *debug_info,
              debug_info->cur_frame_processing_time,
              uS_per_frame,
              debug_info->frame_index / ((long double) debug_info->uS_elapsed / N_uSECONDS_IN_ONE_SEC),
+             debug_info->n_reused_cells,
+             debug_info->quality_level,
+             debug_info->pipe_occupancy,
+             debug_info->n_short_reads,
+             debug_info->seek_latency_us,
+             capture_latency,
              n_cols,
              n_rows
              );
@@ -151,26 +206,345 @@ void colored_display(const char *symbol, unsigned char r, unsigned char g, unsig
     printw(symbol);
 }
 
-void draw_frame(const frame_params_t *frame_params,
-                const kernel_params_t *kernel_params,
-                charset_params_t charset_params,
-                int left_border_indent,
-                region_intensity_t get_region_intensity,
-                display_method_t display_method) {
+void init_cell_cache(cell_cache_t *cell_cache) {
+    cell_cache->cells = NULL;
+    cell_cache->n_rows = 0;
+    cell_cache->n_cols = 0;
+    cell_cache->kernel_width = 0;
+    cell_cache->kernel_height = 0;
+    cell_cache->n_reused = 0;
+}
+
+void invalidate_cell_cache(cell_cache_t *cell_cache) {
+    cell_cache->kernel_width = 0;  // forces fit_cell_cache to drop every cell
+}
+
+void free_cell_cache(cell_cache_t *cell_cache) {
+    free(cell_cache->cells);
+    init_cell_cache(cell_cache);
+}
+
+int fit_cell_cache(cell_cache_t *cell_cache,
+                   const frame_params_t *frame_params,
+                   const kernel_params_t *kernel_params) {
+    cell_cache->n_reused = 0;
+    int n_rows = kernel_params->row_axis
+            ? kernel_params->row_axis->grid_length
+            : frame_params->trimmed_height / kernel_params->width;
+    int n_cols = kernel_params->col_axis
+            ? kernel_params->col_axis->grid_length
+            : frame_params->trimmed_width / kernel_params->height;
+    if (cell_cache->n_rows == n_rows && cell_cache->n_cols == n_cols &&
+        cell_cache->kernel_width == kernel_params->width &&
+        cell_cache->kernel_height == kernel_params->height)
+        return SUCCESS;
+
+    // grid or footprint changed: nothing cached so far is valid
+    cell_t *new_cells = realloc(cell_cache->cells, sizeof(cell_t) * n_rows * n_cols);
+    if (!new_cells && n_rows * n_cols != 0) {
+        fprintf(stderr, "Couldn't allocate cell cache!");
+        return CACHE_ALLOCATION_ERROR;
+    }
+    for (int i = 0; i < n_rows * n_cols; ++i)
+        new_cells[i].valid = 0;
+
+    cell_cache->cells = new_cells;
+    cell_cache->n_rows = n_rows;
+    cell_cache->n_cols = n_cols;
+    cell_cache->kernel_width = kernel_params->width;
+    cell_cache->kernel_height = kernel_params->height;
+    return SUCCESS;
+}
+
+typedef void (*convolve_method_t)(const frame_params_t *frame_params,
+                                  const kernel_params_t *kernel_params,
+                                  int cur_pixel_row,
+                                  int cur_pixel_col,
+                                  double *r, double *g, double *b);
+
+typedef void (*convolve_gradient_method_t)(const frame_params_t *frame_params,
+                                           const kernel_params_t *kernel_params,
+                                           int cur_pixel_row,
+                                           int cur_pixel_col,
+                                           double *r, double *g, double *b,
+                                           double *gradient_x, double *gradient_y);
+
+typedef void (*present_method_t)(const cell_t *row_cells, int n_cells, int cur_char_row, int left_border_indent);
+
+static inline void present_simple_row(const cell_t *row_cells, int n_cells, int cur_char_row, int left_border_indent) {
+    move(cur_char_row, left_border_indent);
+    for (int i = 0; i < n_cells; ++i)
+        addch((unsigned char) row_cells[i].symbol);
+}
+
+// headless output: cells stay in the cache and are written out by write_frame_text
+static inline void present_nothing(const cell_t *row_cells, int n_cells, int cur_char_row, int left_border_indent) {
+    (void) row_cells;
+    (void) n_cells;
+    (void) cur_char_row;
+    (void) left_border_indent;
+}
+
+static inline void present_colored_row(const cell_t *row_cells, int n_cells, int cur_char_row, int left_border_indent) {
+    move(cur_char_row, left_border_indent);
+    for (int i = 0; i < n_cells; ++i) {
+        attrset(COLOR_PAIR(get_color_index(row_cells[i].r, row_cells[i].g, row_cells[i].b)));
+        addch((unsigned char) row_cells[i].symbol);
+    }
+    attrset(A_NORMAL);
+}
+
+// glyphs run along an edge, i.e. across the gradient (y grows downwards); indexed by get_edge_direction
+#define EDGE_DIRECTION_N 4
+static const char edge_glyphs[EDGE_DIRECTION_N] = {'|', '/', '-', '\\'};
+
+// 45 degree bins centered on the glyph angles, without atan2: tan(22.5) ~ 2 / 5
+static inline __attribute__((always_inline)) int get_edge_direction(double gradient_x, double gradient_y) {
+    double abs_x = fabs(gradient_x), abs_y = fabs(gradient_y);
+    if (abs_y * 5 < abs_x * 2)
+        return 0;  // horizontal gradient: vertical edge
+    if (abs_x * 5 < abs_y * 2)
+        return 2;  // vertical gradient: horizontal edge
+    return ((gradient_x > 0) == (gradient_y > 0)) ? 1 : 3;
+}
+
+// fills a recomputed cell: an edge glyph when the gradient is steep enough, a brightness glyph otherwise
+static inline __attribute__((always_inline)) void store_cell(cell_t *cell,
+                                                             uint64_t hash,
+                                                             double r, double g, double b,
+                                                             double gradient_x, double gradient_y,
+                                                             double sqr_edge_threshold,
+                                                             const charset_params_t *charset_params,
+                                                             int edge_flag,
+                                                             region_intensity_t get_region_intensity) {
+    cell->hash = hash;
+    if (edge_flag && gradient_x * gradient_x + gradient_y * gradient_y > sqr_edge_threshold)
+        cell->symbol = edge_glyphs[get_edge_direction(gradient_x, gradient_y)];
+    else
+        cell->symbol = get_char_given_intensity(get_region_intensity(r, g, b), charset_params->char_set,
+                                                charset_params->last_index);
+    cell->r = (unsigned char) r;
+    cell->g = (unsigned char) g;
+    cell->b = (unsigned char) b;
+    cell->valid = 1;
+}
+
+// Body shared by all draw_row variants. It is always inlined into DEFINE_DRAW_ROW wrappers
+// with constant method arguments, so the compiler sees straight-line code for each combination
+// instead of indirect calls per cell.
+static inline __attribute__((always_inline)) void draw_row_template(const frame_params_t *frame_params,
+                                                                    const kernel_params_t *kernel_params,
+                                                                    charset_params_t charset_params,
+                                                                    int edge_threshold,
+                                                                    int left_border_indent,
+                                                                    cell_cache_t *cell_cache,
+                                                                    int cur_char_row,
+                                                                    int cur_pixel_row,
+                                                                    convolve_method_t convolve_method,
+                                                                    convolve_gradient_method_t convolve_gradient_method,
+                                                                    int edge_flag,
+                                                                    region_intensity_t get_region_intensity,
+                                                                    present_method_t present_row) {
     double r, g, b;
-    static char displaying_symbol[2];
-
-    for (int cur_char_row=0, cur_pixel_row=0;
-         cur_pixel_row < frame_params->trimmed_height;
-         ++cur_char_row, cur_pixel_row += kernel_params->width) {
-        move(cur_char_row, left_border_indent);
-        for (int cur_pixel_col=0;
-             cur_pixel_col < frame_params->trimmed_width;
-             cur_pixel_col += kernel_params->height) {
-            convolve(frame_params, kernel_params, cur_pixel_row, cur_pixel_col, &r, &g, &b);
-            displaying_symbol[0] = get_char_given_intensity(get_region_intensity(r, g, b), charset_params.char_set,
-                                                            charset_params.last_index);
-            display_method(displaying_symbol, (unsigned char) r, (unsigned char) g, (unsigned char) b);
+    double gradient_x = 0, gradient_y = 0;
+    double sqr_edge_threshold = (double) edge_threshold * edge_threshold;
+
+    cell_t *row_cells = cell_cache->cells + cur_char_row * cell_cache->n_cols;
+    cell_t *cell = row_cells;
+    for (int cur_pixel_col=0;
+         cur_pixel_col < frame_params->trimmed_width;
+         cur_pixel_col += kernel_params->height, ++cell) {
+        uint64_t hash = tile_hash_inline(frame_params, kernel_params, cur_pixel_row, cur_pixel_col);
+        if (cell->valid && cell->hash == hash) {
+            ++cell_cache->n_reused;
+            continue;
         }
+        if (edge_flag)
+            convolve_gradient_method(frame_params, kernel_params, cur_pixel_row, cur_pixel_col,
+                                     &r, &g, &b, &gradient_x, &gradient_y);
+        else
+            convolve_method(frame_params, kernel_params, cur_pixel_row, cur_pixel_col, &r, &g, &b);
+        store_cell(cell, hash, r, g, b, gradient_x, gradient_y, sqr_edge_threshold, &charset_params,
+                   edge_flag, get_region_intensity);
     }
+    present_row(row_cells, cell_cache->n_cols, cur_char_row, left_border_indent);
+}
+
+// area filter: footprints differ from cell to cell, so they are taken from the resample tables
+// instead of stepping by a fixed kernel size
+static inline __attribute__((always_inline)) void draw_row_area_template(const frame_params_t *frame_params,
+                                                                         const kernel_params_t *kernel_params,
+                                                                         charset_params_t charset_params,
+                                                                         int edge_threshold,
+                                                                         int left_border_indent,
+                                                                         cell_cache_t *cell_cache,
+                                                                         int cur_char_row,
+                                                                         int cur_pixel_row,
+                                                                         int edge_flag,
+                                                                         region_intensity_t get_region_intensity,
+                                                                         present_method_t present_row) {
+    double r, g, b;
+    double gradient_x = 0, gradient_y = 0;
+    double sqr_edge_threshold = (double) edge_threshold * edge_threshold;
+    const resample_axis_t *cols = kernel_params->col_axis;
+    int n_pixel_rows = kernel_params->row_axis->lengths[cur_char_row];
+
+    cell_t *row_cells = cell_cache->cells + cur_char_row * cell_cache->n_cols;
+    cell_t *cell = row_cells;
+    for (int cur_char_col = 0; cur_char_col < cell_cache->n_cols; ++cur_char_col, ++cell) {
+        uint64_t hash = region_hash_inline(frame_params, cur_pixel_row, cols->starts[cur_char_col],
+                                           n_pixel_rows, cols->lengths[cur_char_col]);
+        if (cell->valid && cell->hash == hash) {
+            ++cell_cache->n_reused;
+            continue;
+        }
+        if (edge_flag)
+            convolve_area_gradient(frame_params, kernel_params, cur_pixel_row, cur_char_row, cur_char_col,
+                                   &r, &g, &b, &gradient_x, &gradient_y);
+        else
+            convolve_area(frame_params, kernel_params, cur_pixel_row, cur_char_row, cur_char_col, &r, &g, &b);
+        store_cell(cell, hash, r, g, b, gradient_x, gradient_y, sqr_edge_threshold, &charset_params,
+                   edge_flag, get_region_intensity);
+    }
+    present_row(row_cells, cell_cache->n_cols, cur_char_row, left_border_indent);
+}
+
+// FILTER is uniform or weighted: picks convolve_FILTER and its gradient twin
+#define DEFINE_DRAW_ROW(NAME, FILTER, EDGES, INTENSITY, PRESENT)                    \
+static void NAME(const frame_params_t *frame_params,                               \
+                 const kernel_params_t *kernel_params,                             \
+                 charset_params_t charset_params,                                  \
+                 int edge_threshold,                                               \
+                 int left_border_indent,                                           \
+                 cell_cache_t *cell_cache,                                         \
+                 int cur_char_row,                                                 \
+                 int cur_pixel_row) {                                              \
+    draw_row_template(frame_params, kernel_params, charset_params, edge_threshold, \
+                      left_border_indent,                                          \
+                      cell_cache, cur_char_row, cur_pixel_row,                     \
+                      convolve_##FILTER, convolve_##FILTER##_gradient, EDGES,      \
+                      INTENSITY, PRESENT);                                         \
+}
+
+#define DEFINE_DRAW_ROW_AREA(NAME, EDGES, INTENSITY, PRESENT)                        \
+static void NAME(const frame_params_t *frame_params,                               \
+                 const kernel_params_t *kernel_params,                             \
+                 charset_params_t charset_params,                                  \
+                 int edge_threshold,                                               \
+                 int left_border_indent,                                           \
+                 cell_cache_t *cell_cache,                                         \
+                 int cur_char_row,                                                 \
+                 int cur_pixel_row) {                                              \
+    draw_row_area_template(frame_params, kernel_params, charset_params, edge_threshold, \
+                           left_border_indent,                                     \
+                           cell_cache, cur_char_row, cur_pixel_row, EDGES,         \
+                           INTENSITY, PRESENT);                                    \
+}
+
+DEFINE_DRAW_ROW(draw_row_naive_average_simple, uniform, 0, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_naive_average_colored, uniform, 0, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_naive_average_headless, uniform, 0, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_simple, uniform, 0, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_colored, uniform, 0, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_headless, uniform, 0, yuv_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_gauss_average_simple, weighted, 0, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_gauss_average_colored, weighted, 0, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_gauss_average_headless, weighted, 0, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_simple, weighted, 0, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_colored, weighted, 0, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_headless, weighted, 0, yuv_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_naive_average_simple_edges, uniform, 1, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_naive_average_colored_edges, uniform, 1, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_naive_average_headless_edges, uniform, 1, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_simple_edges, uniform, 1, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_colored_edges, uniform, 1, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_naive_yuv_headless_edges, uniform, 1, yuv_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_gauss_average_simple_edges, weighted, 1, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_gauss_average_colored_edges, weighted, 1, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_gauss_average_headless_edges, weighted, 1, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_simple_edges, weighted, 1, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_colored_edges, weighted, 1, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW(draw_row_gauss_yuv_headless_edges, weighted, 1, yuv_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_simple, 0, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_colored, 0, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_headless, 0, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_simple, 0, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_colored, 0, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_headless, 0, yuv_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_simple_edges, 1, average_chanel_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_colored_edges, 1, average_chanel_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_average_headless_edges, 1, average_chanel_intensity_inline, present_nothing)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_simple_edges, 1, yuv_intensity_inline, present_simple_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_colored_edges, 1, yuv_intensity_inline, present_colored_row)
+DEFINE_DRAW_ROW_AREA(draw_row_area_yuv_headless_edges, 1, yuv_intensity_inline, present_nothing)
+
+// [edges][filter: weighted, uniform, area][yuv][output]
+static draw_row_method_t draw_row_methods[2][3][2][OUTPUT_N] = {
+        {
+                {
+                        {draw_row_gauss_average_simple, draw_row_gauss_average_colored, draw_row_gauss_average_headless},
+                        {draw_row_gauss_yuv_simple, draw_row_gauss_yuv_colored, draw_row_gauss_yuv_headless}
+                },
+                {
+                        {draw_row_naive_average_simple, draw_row_naive_average_colored, draw_row_naive_average_headless},
+                        {draw_row_naive_yuv_simple, draw_row_naive_yuv_colored, draw_row_naive_yuv_headless}
+                },
+                {
+                        {draw_row_area_average_simple, draw_row_area_average_colored, draw_row_area_average_headless},
+                        {draw_row_area_yuv_simple, draw_row_area_yuv_colored, draw_row_area_yuv_headless}
+                }
+        },
+        {
+                {
+                        {draw_row_gauss_average_simple_edges, draw_row_gauss_average_colored_edges, draw_row_gauss_average_headless_edges},
+                        {draw_row_gauss_yuv_simple_edges, draw_row_gauss_yuv_colored_edges, draw_row_gauss_yuv_headless_edges}
+                },
+                {
+                        {draw_row_naive_average_simple_edges, draw_row_naive_average_colored_edges, draw_row_naive_average_headless_edges},
+                        {draw_row_naive_yuv_simple_edges, draw_row_naive_yuv_colored_edges, draw_row_naive_yuv_headless_edges}
+                },
+                {
+                        {draw_row_area_average_simple_edges, draw_row_area_average_colored_edges, draw_row_area_average_headless_edges},
+                        {draw_row_area_yuv_simple_edges, draw_row_area_yuv_colored_edges, draw_row_area_yuv_headless_edges}
+                }
+        }
+};
+
+draw_row_method_t get_draw_row_method(kernel_update_method update_kernel,
+                                      region_intensity_t get_region_intensity,
+                                      output_t output,
+                                      int edge_flag) {
+    // any kernel other than the naive and area ones goes through the generic weighted convolution
+    int filter_ind = (update_kernel == update_area) ? 2 : (update_kernel == update_naive);
+    return draw_row_methods[edge_flag != 0]
+                           [filter_ind]
+                           [get_region_intensity == yuv_intensity]
+                           [output];
+}
+
+void write_frame_text(const cell_cache_t *cell_cache, FILE *output) {
+    const cell_t *cell = cell_cache->cells;
+    for (int row_ind = 0; row_ind < cell_cache->n_rows; ++row_ind) {
+        for (int col_ind = 0; col_ind < cell_cache->n_cols; ++col_ind, ++cell)
+            putc(cell->symbol, output);
+        putc('\n', output);
+    }
+    putc('\n', output);
+}
+
+int draw_frame(const frame_params_t *frame_params,
+               const kernel_params_t *kernel_params,
+               charset_params_t charset_params,
+               int edge_threshold,
+               int left_border_indent,
+               draw_row_method_t draw_row,
+               cell_cache_t *cell_cache) {
+    int status;
+    if ((status = fit_cell_cache(cell_cache, frame_params, kernel_params)))
+        return status;
+
+    for (int cur_char_row = 0; cur_char_row < cell_cache->n_rows; ++cur_char_row)
+        draw_row(frame_params, kernel_params, charset_params, edge_threshold, left_border_indent,
+                 cell_cache, cur_char_row, get_footprint_row(kernel_params, cur_char_row));
+    return SUCCESS;
 }
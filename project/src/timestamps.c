@@ -14,10 +14,33 @@ timespec diff(timespec *start, timespec *end) {
 }
 
 
-// total time elapsed from start
-uint64_t get_elapsed_time_from_start_us(timespec startTime) {
+static uint64_t get_elapsed_time_us(clockid_t clock_id, timespec startTime) {
     static timespec tmpTime, diffTime;
-    clock_gettime(CLOCK_MONOTONIC_COARSE, &tmpTime);
+    clock_gettime(clock_id, &tmpTime);
     diffTime = diff(&startTime, &tmpTime);
     return  ((uint64_t) diffTime.tv_sec * N_uSECONDS_IN_ONE_SEC * 1000 + (uint64_t) diffTime.tv_nsec) / 1000;
 }
+
+// total time elapsed from start
+uint64_t get_elapsed_time_from_start_us(timespec startTime) {
+    return get_elapsed_time_us(CLOCK_MONOTONIC_COARSE, startTime);
+}
+
+uint64_t get_precise_elapsed_time_us(timespec startTime) {
+    return get_elapsed_time_us(CLOCK_MONOTONIC, startTime);
+}
+
+void reset_work_timer(work_timer_t *timer) {
+    timer->total_us = 0;
+}
+
+void start_work_timer(work_timer_t *timer) {
+    clock_gettime(CLOCK_MONOTONIC, &timer->start);
+}
+
+void stop_work_timer(work_timer_t *timer) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timespec elapsed = diff(&timer->start, &now);
+    timer->total_us += (uint64_t) elapsed.tv_sec * N_uSECONDS_IN_ONE_SEC + elapsed.tv_nsec / 1000;
+}
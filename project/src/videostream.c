@@ -1,6 +1,13 @@
 //
 // Created by blackdeer on 5/17/22.
 //
+#define _GNU_SOURCE  // pipe2
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -41,34 +48,75 @@ int get_frame_data(const char *filepath, int *frame_width, int *frame_height) {
 }
 
 
-FILE *get_camera_stream(int frame_width, int frame_height) {
-    int n_chars_printed = snprintf(command_buffer, COMMAND_BUFFER_SIZE,
-                                   "ffmpeg -hide_banner -loglevel error "
-                                   "-f v4l2 -i /dev/video0 -f image2pipe "
-                                   "-vf fps=%d -vf scale=%d:%d -vcodec rawvideo -pix_fmt rgb24 -",
+FILE *get_camera_stream(const ffmpeg_params_t *ffmpeg_params, int frame_width, int frame_height,
+                        capture_log_t *capture_log) {
+    int n_chars_printed;
+    int log_fd[2] = {-1, -1};
+    if (!ffmpeg_params->low_latency_flag) {
+        n_chars_printed = snprintf(command_buffer, COMMAND_BUFFER_SIZE,
+                                   "ffmpeg -nostdin -hide_banner -loglevel error "
+                                   "-f %s -i '%s' -f image2pipe "
+                                   "-vf fps=%d,scale=%d:%d -vcodec rawvideo -pix_fmt rgb24 -",
+                                   ffmpeg_params->camera_format, ffmpeg_params->camera_input,
                                    VIDEO_FRAMERATE, frame_width, frame_height);
+    } else {
+        // ffmpeg inherits the write end as its stderr, so only the read end is close-on-exec
+        if (pipe(log_fd)) {
+            fprintf(stderr, "Error setting up camera! Couldn't create a pipe for its log!\n");
+            return NULL;
+        }
+        fcntl(log_fd[0], F_SETFD, FD_CLOEXEC);
+        // v4l2 stamps frames as the driver captured them, converted to the wall clock by -ts abs;
+        // other inputs are stamped with the wall clock as the demuxer receives them
+        const char *capture_time_option = strcmp(ffmpeg_params->camera_format, "v4l2")
+                                          ? "-use_wallclock_as_timestamps 1"
+                                          : "-ts abs";
+        // nothing is buffered or probed on input, no frames are dropped or duplicated to a fixed rate
+        // and the muxer flushes every frame; -copyts keeps the capture stamps, settb=AVTB brings them
+        // to microseconds and showinfo reports them on the log pipe
+        n_chars_printed = snprintf(command_buffer, COMMAND_BUFFER_SIZE,
+                                   "ffmpeg -nostdin -hide_banner -loglevel info -nostats "
+                                   "-fflags nobuffer -flags low_delay -probesize 32 -analyzeduration 0 "
+                                   "%s -f %s -i '%s' -copyts "
+                                   "-vf settb=AVTB,scale=%d:%d,showinfo=checksum=0 "
+                                   "-fps_mode passthrough -flush_packets 1 "
+                                   "-f rawvideo -vcodec rawvideo -pix_fmt rgb24 - 2>&%d",
+                                   capture_time_option, ffmpeg_params->camera_format, ffmpeg_params->camera_input,
+                                   frame_width, frame_height, log_fd[1]);
+    }
+
+    // sets up stream from where we read our RGB frames
+    FILE *video_stream = NULL;
     if (n_chars_printed < 0) {
         fprintf(stderr, "Error setting up camera!\n");
-        return NULL;
     } else if (n_chars_printed >= COMMAND_BUFFER_SIZE) {
         fprintf(stderr, "Error setting up camera! Query size is too big!\n");
-        return NULL;
+    } else if (!(video_stream = popen(command_buffer, "r"))) {
+        fprintf(stderr, "Error setting up camera! Couldn't set an interface with camera!\n");
     }
-    // sets up stream from where we read our RGB frames
-    FILE *video_stream = popen(command_buffer, "r");
+    if (log_fd[1] >= 0)
+        close(log_fd[1]);
     if (!video_stream) {
-        fprintf(stderr, "Error setting up camera! Couldn't set an interface with camera!\n");
+        if (log_fd[0] >= 0)
+            close(log_fd[0]);
         return NULL;
     }
+    if (log_fd[0] >= 0) {
+        init_capture_log(capture_log);
+        capture_log->log_fd = log_fd[0];
+        fcntl(capture_log->log_fd, F_SETFL, O_NONBLOCK);
+    }
     return video_stream;
 }
 
 
-FILE *get_file_stream(const char *file_path, int n_stream_loops) {
+FILE *get_file_stream(const char *file_path, int n_stream_loops, double start_time) {
+    // input seeking: the demuxer jumps there, nothing before start_time is decoded when it's a keyframe;
+    // -nostdin keeps ffmpeg from eating keys meant for the interactive controls
     int n_chars_printed = snprintf(command_buffer, COMMAND_BUFFER_SIZE,
-                               "ffmpeg -stream_loop %d -i %s -f image2pipe -hide_banner -loglevel error "
+                               "ffmpeg -nostdin -stream_loop %d -ss %f -i %s -f image2pipe -hide_banner -loglevel error "
                                "-vf fps=%d -vcodec rawvideo -pix_fmt rgb24 -",
-                               n_stream_loops, file_path, VIDEO_FRAMERATE);
+                               n_stream_loops, start_time, file_path, VIDEO_FRAMERATE);
     if (n_chars_printed < 0) {
         fprintf(stderr, "Error preparing ffmpeg command!\n");
         return NULL;
@@ -86,64 +134,207 @@ FILE *get_file_stream(const char *file_path, int n_stream_loops) {
 }
 
 
-int start_player(char *file_path, int n_stream_loops, char *player_type) {
-    if (!player_type)
-        return SUCCESS;
+#define PLAYER_START_TIMEOUT_MS 10000
+#define PLAYER_LOOP_TOLERANCE 1.0  // seconds; a bigger jump back in pts means the player looped
+#define PTS_TIME_FIELD "pts_time:"
 
-    FILE *ffplay_log_file = NULL;
-    if (!(ffplay_log_file = fopen("StartIndicator", "w+"))) {
-        fprintf(stderr, "Couldn't open StartIndicator!");
-        return FOPEN_ERROR;
+typedef void (*log_line_parser_t)(void *context, const char *line);
+
+// feeds complete lines waiting in a non-blocking log pipe to parse_line;
+// closes the pipe and returns -1 once the writer closed it
+static int read_log_lines(int *log_fd, char *log_line, size_t *log_line_length,
+                          log_line_parser_t parse_line, void *context) {
+    char read_buffer[PLAYER_LOG_LINE_SIZE];
+    ssize_t n_read;
+    while ((n_read = read(*log_fd, read_buffer, sizeof(read_buffer))) > 0) {
+        for (ssize_t i = 0; i < n_read; ++i) {
+            if (read_buffer[i] == '\n' || read_buffer[i] == '\r' ||
+                *log_line_length == PLAYER_LOG_LINE_SIZE - 1) {
+                log_line[*log_line_length] = '\0';
+                parse_line(context, log_line);
+                *log_line_length = 0;
+            } else {
+                log_line[(*log_line_length)++] = read_buffer[i];
+            }
+        }
+    }
+    if (!n_read || (errno != EAGAIN && errno != EINTR)) {
+        close(*log_fd);
+        *log_fd = -1;
+        return -1;
+    }
+    return SUCCESS;
+}
+
+static void parse_player_line(void *context, const char *line) {
+    player_t *player = context;
+    // showinfo/ashowinfo report every frame as "... pts_time:<seconds> ..."
+    const char *pts_field = strstr(line, PTS_TIME_FIELD);
+    if (!pts_field)
+        return;
+
+    // audio is the master clock whenever the player has it
+    int is_audio = strstr(line, "ashowinfo") != NULL;
+    if (!is_audio && player->audio_clock)
+        return;
+    if (is_audio && !player->audio_clock) {
+        player->audio_clock = 1;
+        player->last_pts = 0;
     }
 
+    double pts = strtod(pts_field + strlen(PTS_TIME_FIELD), NULL);
+    if (pts + PLAYER_LOOP_TOLERANCE < player->last_pts)
+        player->loop_offset += player->last_pts;
+    player->last_pts = pts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &player->position_time);
+    player->has_position = 1;
+}
+
+int update_player_position(player_t *player) {
+    if (player->log_fd < 0)
+        return -1;
+    // the player closing its stderr means it exited
+    return read_log_lines(&player->log_fd, player->log_line, &player->log_line_length,
+                          parse_player_line, player);
+}
+
+#define CAPTURE_PTS_FIELD " pts:"
+
+static void parse_capture_line(void *context, const char *line) {
+    capture_log_t *capture_log = context;
+    // showinfo reports every frame as "... n:<index> pts:<microseconds> ..."
+    const char *pts_field = strstr(line, CAPTURE_PTS_FIELD);
+    if (!pts_field || !strstr(line, "showinfo"))
+        return;
+    capture_log->capture_times_us[capture_log->n_reported++ % CAPTURE_TIMES_N] =
+            strtoll(pts_field + strlen(CAPTURE_PTS_FIELD), NULL, 10);
+}
+
+void init_capture_log(capture_log_t *capture_log) {
+    capture_log->log_fd = -1;
+    capture_log->log_line_length = 0;
+    capture_log->n_reported = 0;
+}
+
+int update_capture_log(capture_log_t *capture_log) {
+    if (capture_log->log_fd < 0)
+        return -1;
+    return read_log_lines(&capture_log->log_fd, capture_log->log_line, &capture_log->log_line_length,
+                          parse_capture_line, capture_log);
+}
+
+int64_t get_capture_time_us(const capture_log_t *capture_log, size_t frame_number) {
+    if (frame_number >= capture_log->n_reported || capture_log->n_reported - frame_number > CAPTURE_TIMES_N)
+        return -1;
+    return capture_log->capture_times_us[frame_number % CAPTURE_TIMES_N];
+}
+
+void close_capture_log(capture_log_t *capture_log) {
+    if (capture_log->log_fd >= 0)
+        close(capture_log->log_fd);
+    init_capture_log(capture_log);
+}
+
+int64_t get_player_time_us(const player_t *player) {
+    if (!player->has_position)
+        return -1;
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    timespec since_report = diff((timespec *) &player->position_time, &now);
+    return (int64_t) ((player->loop_offset + player->last_pts) * N_uSECONDS_IN_ONE_SEC) +
+           (int64_t) since_report.tv_sec * N_uSECONDS_IN_ONE_SEC + since_report.tv_nsec / 1000;
+}
+
+void stop_player(player_t *player) {
+    if (player->pid > 0) {
+        kill(player->pid, SIGTERM);
+        kill(player->pid, SIGCONT);  // a paused player only handles SIGTERM once it runs again
+        waitpid(player->pid, NULL, 0);
+    }
+    if (player->log_fd >= 0)
+        close(player->log_fd);
+    player->pid = -1;
+    player->log_fd = -1;
+}
+
+void pause_player(player_t *player) {
+    if (player->pid > 0)
+        kill(player->pid, SIGSTOP);
+}
+
+void resume_player(player_t *player) {
+    if (player->pid > 0)
+        kill(player->pid, SIGCONT);
+    // the last position is still current: don't extrapolate over the pause
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &player->position_time);
+}
+
+void init_player(player_t *player) {
+    player->pid = -1;
+    player->log_fd = -1;
+    player->log_line_length = 0;
+    player->has_position = 0;
+    player->audio_clock = 0;
+    player->last_pts = 0;
+    player->loop_offset = 0;
+}
+
+int spawn_player(player_t *player, char *file_path, int n_stream_loops, char *player_type, double start_time) {
+    init_player(player);
+    if (!player_type)
+        return SUCCESS;
+
     int fd[2];
-    if (pipe(fd)) {
+    if (pipe2(fd, O_CLOEXEC)) {
         fprintf(stderr, "[start_player] Couldn't create a pipe between processes!");
         return POPEN_ERROR;
     }
 
-    int status = SUCCESS;
-    if (!fork()) {
-        close(fd[0]);
-        snprintf(command_buffer, COMMAND_BUFFER_SIZE,
-                 "FFREPORT=file=StartIndicator:level=32 "
-                 "ffplay %s -loop %d %s -hide_banner -loglevel error -nostats -vf showinfo -framedrop ",
-                 player_type, n_stream_loops, file_path);
-        FILE *tmp = NULL;
-        if (!(tmp = popen(command_buffer, "r"))) {
-            fprintf(stderr, "Couldn't start player!");
-            status = POPEN_ERROR;
-        }
-        write(fd[1], &status, sizeof(int));
+    char loops_buffer[16], start_buffer[32];
+    snprintf(loops_buffer, sizeof(loops_buffer), "%d", n_stream_loops);
+    snprintf(start_buffer, sizeof(start_buffer), "%f", start_time);
+    char *player_argv[] = {"ffplay", "-loop", loops_buffer, "-ss", start_buffer, file_path,
+                           "-hide_banner", "-loglevel", "info", "-nostats",
+                           "-vf", "showinfo", "-af", "ashowinfo", "-framedrop",
+                           player_type[0] ? player_type : NULL, NULL};
+
+    if (!(player->pid = fork())) {
+        // player log goes to our pipe, its stdin/stdout are of no use
+        int null_fd = open("/dev/null", O_RDWR);
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(fd[1], STDERR_FILENO);
+        execvp(player_argv[0], player_argv);
+        _exit(POPEN_ERROR);
+    } else if (player->pid < 0) {
+        fprintf(stderr, "Couldn't start player!");
         close(fd[0]);
-        pclose(tmp);
-        exit(status);
+        close(fd[1]);
+        return POPEN_ERROR;
     }
-    if (!strcmp(player_type, "-nodisp"))
-        return SUCCESS;
-
     close(fd[1]);
-    read(fd[0], &status, sizeof(int));
-    if (status)
-        return status;
-
-    int brackets_count = 0;
-    while (brackets_count < 3) {
-        int current_symbol;
-        if ((current_symbol = getc(ffplay_log_file)) == EOF) {
-            size_t current_file_position = ftell(ffplay_log_file) - 1;
-
-            fclose(ffplay_log_file);
-            if (!(ffplay_log_file = fopen("StartIndicator", "r"))) {
-                fprintf(stderr, "Couldn't reopen StartIndicator!");
-                return FOPEN_ERROR;
-            }
+    player->log_fd = fd[0];
+    fcntl(player->log_fd, F_SETFL, O_NONBLOCK);
+    return SUCCESS;
+}
 
-            fseek(ffplay_log_file, current_file_position, SEEK_SET);
-        } else if (current_symbol == '[') {
-            ++brackets_count;
+int start_player(player_t *player, char *file_path, int n_stream_loops, char *player_type, double start_time) {
+    int return_status;
+    if ((return_status = spawn_player(player, file_path, n_stream_loops, player_type, start_time)) ||
+        player->log_fd < 0)
+        return return_status;
+
+    // sleep in poll() until the first frame is reported
+    while (!player->has_position) {
+        struct pollfd log_poll = {player->log_fd, POLLIN, 0};
+        int n_ready = poll(&log_poll, 1, PLAYER_START_TIMEOUT_MS);
+        if (n_ready < 0 && errno == EINTR)
+            continue;
+        if (n_ready <= 0 || update_player_position(player)) {
+            fprintf(stderr, "Couldn't start player!");
+            stop_player(player);
+            return POPEN_ERROR;
         }
     }
-    fclose(ffplay_log_file);
     return SUCCESS;
 }
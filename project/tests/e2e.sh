@@ -0,0 +1,133 @@
+#!/usr/bin/env bash
+# End-to-end checks of the whole pipeline (ffmpeg -> pipe -> conversion -> headless sink)
+# on deterministic clips generated with ffmpeg's lavfi sources.
+# usage: e2e.sh <pix2ascii binary> <tests source dir> <work dir> <test_throughput binary> [--update]
+# The fps floor is relative to the reference pass of test_throughput, timed on the same machine.
+
+set -o pipefail
+
+SKIP_RETURN_CODE=77
+FLOOR_RATIO=0.5
+CLIP_SECONDS=2
+CLIP_FRAMES=50      # CLIP_SECONDS at 25 fps
+GOLDEN_SECONDS=0.4
+GOLDEN_FRAMES=10
+
+BINARY=$(realpath "${1}")
+TESTS_DIR=$(realpath "${2}")
+WORK_DIR="${3}"
+REFERENCE_BINARY=$(realpath "${4}")
+UPDATE_FLAG="${5}"
+
+if ! command -v ffmpeg > /dev/null || ! command -v ffprobe > /dev/null; then
+    echo "ffmpeg/ffprobe not found, skipping"
+    exit ${SKIP_RETURN_CODE}
+fi
+
+mkdir -p "${WORK_DIR}" && cd "${WORK_DIR}" || exit 1
+N_FAILED=0
+REFERENCE_RATE=$("${REFERENCE_BINARY}" --reference | sed -n 's/^reference \([0-9.]*\) passes\/s$/\1/p')
+
+function fail() {
+    echo "FAIL ${1}"
+    N_FAILED=$((N_FAILED + 1))
+}
+
+# make_clip <lavfi source> <size> <seconds> <output>
+function make_clip() {
+    [ -f "${4}" ] || ffmpeg -v error -y -f lavfi -i "${1}=size=${2}:rate=25" -t "${3}" \
+                            -c:v ffv1 -pix_fmt bgr0 "${4}"
+}
+
+# run_headless <clip> <output> <flags...>; prints fps reported by the headless sink
+function run_headless() {
+    local clip="${1}" output="${2}"
+    shift 2
+    "${BINARY}" -f "${clip}" -o "${output}" "$@" 2>&1 < /dev/null | sed -n 's/.*fps: \([0-9.]*\).*/\1/p'
+}
+
+function count_frames() {
+    grep -c '^$' "${1}"
+}
+
+for SOURCE in testsrc mandelbrot; do
+    for SIZE in 320x240 640x360 1280x720; do
+        [ "${SOURCE}" = mandelbrot ] && [ "${SIZE}" = 1280x720 ] && continue  # slow to generate
+        CLIP="${SOURCE}_${SIZE}.nut"
+        make_clip "${SOURCE}" "${SIZE}" "${CLIP_SECONDS}" "${CLIP}" || { fail "${CLIP}: ffmpeg"; continue; }
+
+        FPS=$(run_headless "${CLIP}" frame.txt -maxw 80 -maxh 24) || fail "${CLIP}: pix2ascii exited with error"
+        run_headless "${CLIP}" stream.txt -maxw 80 -maxh 24 --stream > /dev/null
+        [ "$(count_frames frame.txt)" = "${CLIP_FRAMES}" ] || fail "${CLIP}: expected ${CLIP_FRAMES} frames"
+        cmp -s frame.txt stream.txt || fail "${CLIP}: --stream output differs"
+        echo "${CLIP} ${FPS} fps"
+
+        if [ "${SOURCE}" = testsrc ] && [ "${SIZE}" = 1280x720 ]; then
+            BASELINE=$(awk '$1 == "e2e_720p_fps" {print $2}' "${TESTS_DIR}/perf_baseline.txt")
+            RELATIVE_FPS=$(awk -v fps="${FPS}" -v reference="${REFERENCE_RATE}" \
+                               'BEGIN {if (reference > 0) printf "%.3f", fps / reference}')
+            if [ -z "${BASELINE}" ]; then
+                fail "${CLIP}: no e2e_720p_fps baseline"
+            elif [ -z "${RELATIVE_FPS}" ]; then
+                fail "${CLIP}: couldn't run the reference pass"
+            elif awk -v fps="${RELATIVE_FPS}" -v base="${BASELINE}" -v ratio="${FLOOR_RATIO}" \
+                     'BEGIN {exit !(fps < base * ratio)}'; then
+                fail "${CLIP}: ${RELATIVE_FPS} (${FPS} fps) is below ${FLOOR_RATIO} of baseline ${BASELINE}"
+            else
+                echo "${CLIP} ${RELATIVE_FPS} relative to the reference pass, baseline ${BASELINE}"
+            fi
+        fi
+    done
+done
+
+# memory-mapped sources: raw rgb24 must match the decoder pipe exactly, y4m goes through its own YUV conversion
+MAPPED_CLIP=testsrc_320x240.nut
+ffmpeg -v error -y -i "${MAPPED_CLIP}" -pix_fmt rgb24 -f rawvideo mapped.rgb || fail "mapped.rgb: ffmpeg"
+ffmpeg -v error -y -i "${MAPPED_CLIP}" -pix_fmt yuv420p mapped.y4m || fail "mapped.y4m: ffmpeg"
+run_headless "${MAPPED_CLIP}" frame.txt -maxw 80 -maxh 24 > /dev/null
+run_headless mapped.rgb mapped.txt -size 320x240 -maxw 80 -maxh 24 > /dev/null || fail "mapped.rgb: pix2ascii exited with error"
+cmp -s frame.txt mapped.txt || fail "mapped.rgb: output differs from piped decoding"
+run_headless mapped.y4m mapped.txt -maxw 80 -maxh 24 > /dev/null || fail "mapped.y4m: pix2ascii exited with error"
+[ "$(count_frames mapped.txt)" = "${CLIP_FRAMES}" ] || fail "mapped.y4m: expected ${CLIP_FRAMES} frames"
+# seeking half way in and looping once more plays the second half and then the whole clip
+run_headless mapped.y4m mapped.txt -maxw 80 -maxh 24 -ss 1 -nl 1 > /dev/null
+[ "$(count_frames mapped.txt)" = "$((CLIP_FRAMES * 3 / 2))" ] || fail "mapped.y4m: -ss/-nl frame count"
+
+# camera sources, with lavfi standing in for the device: every frame of a --low-latency stream
+# is either drawn or replaced by a newer one, and the drawn ones are timed from capture to display
+CAMERA_INPUT="testsrc2=size=320x240:rate=25:duration=${CLIP_SECONDS}"
+"${BINARY}" -camera-format lavfi -camera-input "${CAMERA_INPUT}" -o camera.txt -maxw 80 -maxh 24 \
+            > /dev/null 2>&1 < /dev/null || fail "camera: pix2ascii exited with error"
+[ "$(count_frames camera.txt)" = "${CLIP_FRAMES}" ] || fail "camera: expected ${CLIP_FRAMES} frames"
+LATENCY_REPORT=$("${BINARY}" -camera-format lavfi -camera-input "${CAMERA_INPUT},realtime,settb=AVTB" --low-latency \
+                             -o camera.txt -maxw 80 -maxh 24 2>&1 < /dev/null) || fail "camera: --low-latency exited with error"
+N_DROPPED=$(echo "${LATENCY_REPORT}" | sed -n 's/.*dropped frames: \([0-9]*\).*/\1/p')
+[ -n "${N_DROPPED}" ] || fail "camera: no capture latency report"
+# -fflags nobuffer discards the frame ffmpeg probed the input with
+N_RECEIVED=$(( $(count_frames camera.txt) + N_DROPPED ))
+[ "${N_RECEIVED}" -ge "$((CLIP_FRAMES - 1))" ] && [ "${N_RECEIVED}" -le "${CLIP_FRAMES}" ] ||
+    fail "camera: --low-latency lost frames"
+echo "${LATENCY_REPORT}" | grep 'capture latency'
+
+GOLDEN_CLIP=golden_testsrc.nut
+make_clip testsrc 320x240 "${GOLDEN_SECONDS}" "${GOLDEN_CLIP}" || fail "${GOLDEN_CLIP}: ffmpeg"
+mkdir -p "${TESTS_DIR}/golden/e2e"
+for SET in sharp optimal standard long; do
+    for FILTER in naive gauss; do
+        for METHOD in average yuv; do
+            GOLDEN="${TESTS_DIR}/golden/e2e/${SET}_${FILTER}_${METHOD}.txt"
+            run_headless "${GOLDEN_CLIP}" golden.txt -maxw 40 -maxh 12 \
+                         -set "${SET}" -filter "${FILTER}" -method "${METHOD}" > /dev/null
+            [ "$(count_frames golden.txt)" = "${GOLDEN_FRAMES}" ] || fail "${GOLDEN}: expected ${GOLDEN_FRAMES} frames"
+            if [ "${UPDATE_FLAG}" = "--update" ]; then
+                cp golden.txt "${GOLDEN}"
+            elif [ ! -f "${GOLDEN}" ]; then
+                fail "${GOLDEN}: golden file is missing"
+            else
+                cmp -s golden.txt "${GOLDEN}" || fail "${GOLDEN}: output differs from golden file"
+            fi
+        done
+    done
+done
+
+[ ${N_FAILED} -eq 0 ]
@@ -0,0 +1,117 @@
+// Keyframe lookup and the on-disk index cache; a stub stands in for ffprobe and counts its runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include "test_utils.h"
+#include "keyframes.h"
+#include "status_codes.h"
+
+#define MEDIA_PATH "test_keyframes_media.bin"
+#define STUB_DIR "test_keyframes_bin"
+#define PROBE_LOG_PATH "test_keyframes_probes.txt"
+#define PATH_BUFFER_SIZE 4096
+
+// two keyframes in one second of packets, 2 s in total
+static const char stub_ffprobe[] =
+        "#!/bin/sh\n"
+        "echo probe >> " PROBE_LOG_PATH "\n"
+        "printf '0.000000,0.500000,K_\\n0.500000,0.500000,__\\n1.000000,0.500000,K_\\n1.500000,0.500000,__\\n'\n";
+
+static int write_file(const char *path, const char *content, const char *mode) {
+    FILE *file = fopen(path, mode);
+    if (!file)
+        return FOPEN_ERROR;
+    fputs(content, file);
+    fclose(file);
+    return SUCCESS;
+}
+
+// a cache that doesn't match the stub's answer: 4 keyframes over 10 s
+static int write_cache(long file_size) {
+    char content[256];
+    snprintf(content, sizeof(content),
+             "# pix2ascii keyframe index\nsize %ld\nduration 10.000000\n0.000000\n2.000000\n4.000000\n8.000000\n",
+             file_size);
+    return write_file(MEDIA_PATH KEYFRAME_INDEX_EXTENSION, content, "w");
+}
+
+static void set_mtime(const char *path, time_t mtime) {
+    struct utimbuf times = {mtime, mtime};
+    utime(path, &times);
+}
+
+static int count_probes(void) {
+    FILE *log = fopen(PROBE_LOG_PATH, "r");
+    if (!log)
+        return 0;
+    int n_probes = 0;
+    for (int c; (c = fgetc(log)) != EOF;)
+        n_probes += c == '\n';
+    fclose(log);
+    return n_probes;
+}
+
+static int install_stub(void) {
+    char cwd[PATH_BUFFER_SIZE], path[2 * PATH_BUFFER_SIZE];
+    mkdir(STUB_DIR, 0755);
+    if (write_file(STUB_DIR "/ffprobe", stub_ffprobe, "w") || chmod(STUB_DIR "/ffprobe", 0755) ||
+        !getcwd(cwd, sizeof(cwd)))
+        return FOPEN_ERROR;
+    snprintf(path, sizeof(path), "%s/%s:%s", cwd, STUB_DIR, getenv("PATH") ? getenv("PATH") : "");
+    return setenv("PATH", path, 1) ? FOPEN_ERROR : SUCCESS;
+}
+
+int main() {
+    keyframe_index_t index;
+    init_keyframe_index(&index);
+    check(find_keyframe(&index, 12.5) == 12.5, "empty index seeks to the exact time");
+
+    unlink(PROBE_LOG_PATH);
+    time_t now = time(NULL);
+    if (install_stub() || write_file(MEDIA_PATH, "0123456789", "w") || write_cache(10)) {
+        fprintf(stderr, "Couldn't create test files!\n");
+        return FOPEN_ERROR;
+    }
+    set_mtime(MEDIA_PATH, now - 60);
+
+    check(load_keyframe_index(&index, MEDIA_PATH) == SUCCESS, "cache next to the file is used");
+    check(count_probes() == 0, "a valid cache isn't probed again");
+    check(index.n_keyframes == 4 && index.duration == 10.0, "cache contents");
+    check(find_keyframe(&index, 0) == 0, "seek to the start");
+    check(find_keyframe(&index, 3.9) == 2.0, "seek between keyframes snaps back");
+    check(find_keyframe(&index, 4.0) == 4.0, "seek onto a keyframe");
+    check(find_keyframe(&index, 9.5) == 8.0, "seek past the last keyframe");
+    free_keyframe_index(&index);
+
+    // rewritten within the same second: only the size tells the cache is stale
+    write_file(MEDIA_PATH, "abc", "a");
+    set_mtime(MEDIA_PATH, now - 60);
+    check(load_keyframe_index(&index, MEDIA_PATH) == SUCCESS, "index is rebuilt after a size change");
+    check(count_probes() == 1, "a size change makes the index probe again");
+    check(index.n_keyframes == 2 && index.duration == 2.0, "rebuilt index holds the probed keyframes");
+    free_keyframe_index(&index);
+    check(load_keyframe_index(&index, MEDIA_PATH) == SUCCESS && count_probes() == 1 && index.n_keyframes == 2,
+          "rebuilt index is cached");
+    free_keyframe_index(&index);
+
+    // same size, modified after the index was written
+    write_cache(13);
+    set_mtime(MEDIA_PATH, now + 60);
+    check(load_keyframe_index(&index, MEDIA_PATH) == SUCCESS, "index is rebuilt after a newer mtime");
+    check(count_probes() == 2, "a newer mtime makes the index probe again");
+    check(index.n_keyframes == 2 && index.duration == 2.0, "index of a modified file comes from the probe");
+    free_keyframe_index(&index);
+
+    unlink(MEDIA_PATH);
+    unlink(MEDIA_PATH KEYFRAME_INDEX_EXTENSION);
+    unlink(PROBE_LOG_PATH);
+    unlink(STUB_DIR "/ffprobe");
+    rmdir(STUB_DIR);
+    return n_failed_checks != 0;
+}
@@ -0,0 +1,190 @@
+// Memory-mapped sources on tiny handcrafted files: raw rgb24 frames, y4m header parsing,
+// the BT.601 conversion of 4:2:0, 4:4:4 and mono y4m, frame rate conversion and -ss offsets.
+// Needs neither ffmpeg nor a terminal.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+#include "mmapstream.h"
+#include "videostream.h"
+#include "status_codes.h"
+
+#define RGB_PATH "test_mmapstream.rgb"
+#define Y4M_PATH "test_mmapstream.y4m"
+#define RGB_WIDTH 2
+#define RGB_HEIGHT 2
+#define RGB_N_FRAMES 3
+#define Y4M_420_N_FRAMES 4
+#define CHANNEL_TOLERANCE 2  // the integer matrix rounds differently from the reference
+
+static int write_file(const char *path, const void *content, size_t size) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return FOPEN_ERROR;
+    size_t n_written = fwrite(content, 1, size, file);
+    fclose(file);
+    return n_written == size ? SUCCESS : FOPEN_ERROR;
+}
+
+static double clamp_reference(double value) {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+// BT.601 limited range in floating point
+static void reference_rgb(int y, int u, int v, double rgb[3]) {
+    double luma = 1.164 * (y - 16);
+    rgb[0] = clamp_reference(luma + 1.596 * (v - 128));
+    rgb[1] = clamp_reference(luma - 0.392 * (u - 128) - 0.813 * (v - 128));
+    rgb[2] = clamp_reference(luma + 2.017 * (u - 128));
+}
+
+static int matches_reference(const unsigned char *pixel, int y, int u, int v) {
+    double rgb[3];
+    reference_rgb(y, u, v, rgb);
+    for (int channel = 0; channel < 3; ++channel)
+        if (fabs(pixel[channel] - rgb[channel]) > CHANNEL_TOLERANCE)
+            return 0;
+    return 1;
+}
+
+static void test_raw(void) {
+    unsigned char frames[RGB_N_FRAMES][RGB_HEIGHT * RGB_WIDTH * 3];
+    for (int frame = 0; frame < RGB_N_FRAMES; ++frame)
+        for (size_t i = 0; i < sizeof(frames[0]); ++i)
+            frames[frame][i] = (unsigned char) (frame * 64 + i);
+    if (write_file(RGB_PATH, frames, sizeof(frames))) {
+        check(0, "raw: couldn't write test file");
+        return;
+    }
+
+    mapped_stream_t stream;
+    check(open_mapped_stream(&stream, RGB_PATH, 0, 0, 0) == FLAG_ERROR, "raw: frame size is required");
+    check(open_mapped_stream(&stream, RGB_PATH, RGB_WIDTH, RGB_HEIGHT, 0) == SUCCESS, "raw: opens");
+    check(stream.n_frames == RGB_N_FRAMES, "raw: frame count");
+    int in_order = 1;
+    for (int frame = 0; frame < RGB_N_FRAMES; ++frame) {
+        unsigned char *pixels = next_mapped_frame(&stream);
+        in_order &= pixels && !memcmp(pixels, frames[frame], sizeof(frames[0]));
+    }
+    check(in_order, "raw: frames come out as written");
+    check(!next_mapped_frame(&stream), "raw: stream ends after its last frame");
+
+    seek_mapped_stream(&stream, 2.0 / VIDEO_FRAMERATE);
+    unsigned char *pixels = next_mapped_frame(&stream);
+    check(pixels && !memcmp(pixels, frames[2], sizeof(frames[0])), "raw: -ss starts on the exact frame");
+    close_mapped_stream(&stream);
+}
+
+// 4x2 pixels at 50 fps: one chroma sample per 2x2 block, luma and chroma distinct per frame
+static void test_y4m_420(void) {
+    static const char header[] = "YUV4MPEG2 W4 H2 F50:1 Ip A1:1 C420jpeg XYSCSS=420JPEG\n";
+    static const char frame_header[] = "FRAME\n";
+    enum {LUMA_SIZE = 4 * 2, CHROMA_SIZE = 2, FRAME_SIZE = LUMA_SIZE + 2 * CHROMA_SIZE};
+    unsigned char planes[Y4M_420_N_FRAMES][FRAME_SIZE];
+    char file[sizeof(header) + Y4M_420_N_FRAMES * (sizeof(frame_header) - 1 + FRAME_SIZE)];
+    size_t size = strlen(header);
+    memcpy(file, header, size);
+    for (int frame = 0; frame < Y4M_420_N_FRAMES; ++frame) {
+        for (int i = 0; i < LUMA_SIZE; ++i)
+            planes[frame][i] = (unsigned char) (16 + frame * 50 + i * 5);
+        planes[frame][LUMA_SIZE] = (unsigned char) (60 + frame * 30);          // U, left block
+        planes[frame][LUMA_SIZE + 1] = (unsigned char) (200 - frame * 20);     // U, right block
+        planes[frame][LUMA_SIZE + 2] = (unsigned char) (180 - frame * 10);     // V, left block
+        planes[frame][LUMA_SIZE + 3] = (unsigned char) (90 + frame * 15);      // V, right block
+        memcpy(file + size, frame_header, strlen(frame_header));
+        size += strlen(frame_header);
+        memcpy(file + size, planes[frame], FRAME_SIZE);
+        size += FRAME_SIZE;
+    }
+    if (write_file(Y4M_PATH, file, size)) {
+        check(0, "y4m 4:2:0: couldn't write test file");
+        return;
+    }
+
+    mapped_stream_t stream;
+    check(open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == SUCCESS, "y4m 4:2:0: opens");
+    check(stream.format == MAPPED_Y4M_420 && stream.width == 4 && stream.height == 2,
+          "y4m 4:2:0: header parsed");
+    check(stream.frame_rate == 50 && stream.n_frames == Y4M_420_N_FRAMES, "y4m 4:2:0: frame rate and count");
+
+    // 50 fps source at 25 fps output: every other frame
+    for (int frame = 0; frame < Y4M_420_N_FRAMES; frame += 2) {
+        unsigned char *pixels = next_mapped_frame(&stream);
+        int converted = pixels != NULL;
+        for (int row = 0; converted && row < 2; ++row)
+            for (int col = 0; col < 4; ++col)
+                converted &= matches_reference(pixels + (row * 4 + col) * 3, planes[frame][row * 4 + col],
+                                               planes[frame][LUMA_SIZE + col / 2],
+                                               planes[frame][LUMA_SIZE + CHROMA_SIZE + col / 2]);
+        check(converted, frame ? "y4m 4:2:0: second output frame is source frame 2"
+                               : "y4m 4:2:0: first frame converts");
+    }
+    check(!next_mapped_frame(&stream), "y4m 4:2:0: stream ends after its last frame");
+
+    // one output frame in is two source frames in
+    seek_mapped_stream(&stream, 1.0 / VIDEO_FRAMERATE);
+    unsigned char *pixels = next_mapped_frame(&stream);
+    check(pixels && matches_reference(pixels, planes[2][0], planes[2][LUMA_SIZE], planes[2][LUMA_SIZE + CHROMA_SIZE]),
+          "y4m 4:2:0: -ss lands on the source frame for its time");
+    close_mapped_stream(&stream);
+}
+
+// 2x1 pixels with their own chroma, none of the channels clipped
+static void test_y4m_444(void) {
+    static const char file[] = "YUV4MPEG2 W2 H1 F25:1 C444\nFRAME\n"
+                               "\x80\x60"   // Y
+                               "\x70\x98"   // U
+                               "\x90\x68";  // V
+    mapped_stream_t stream;
+    check(!write_file(Y4M_PATH, file, sizeof(file) - 1) &&
+          open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == SUCCESS, "y4m 4:4:4: opens");
+    check(stream.format == MAPPED_Y4M_444 && stream.n_frames == 1, "y4m 4:4:4: header parsed");
+    unsigned char *pixels = next_mapped_frame(&stream);
+    check(pixels && matches_reference(pixels, 0x80, 0x70, 0x90) && matches_reference(pixels + 3, 0x60, 0x98, 0x68),
+          "y4m 4:4:4: every pixel uses its own chroma");
+    close_mapped_stream(&stream);
+}
+
+static void test_y4m_mono(void) {
+    static const char file[] = "YUV4MPEG2 W3 H1 F25:1 Cmono\nFRAME\n\x10\x7E\xEB";
+    mapped_stream_t stream;
+    check(!write_file(Y4M_PATH, file, sizeof(file) - 1) &&
+          open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == SUCCESS, "y4m mono: opens");
+    check(stream.format == MAPPED_Y4M_MONO && stream.n_frames == 1, "y4m mono: header parsed");
+    unsigned char *pixels = next_mapped_frame(&stream);
+    check(pixels && pixels[0] == 0 && pixels[1] == 0 && pixels[2] == 0 &&
+          pixels[3] == pixels[4] && pixels[4] == pixels[5] && matches_reference(pixels + 3, 0x7E, 128, 128) &&
+          pixels[6] == 255, "y4m mono: limited range luma to gray");
+    close_mapped_stream(&stream);
+}
+
+static void test_y4m_rejected(void) {
+    static const char unsupported[] = "YUV4MPEG2 W2 H2 F25:1 C422\nFRAME\n01234567";
+    static const char no_size[] = "YUV4MPEG2 F25:1 C444\nFRAME\n012";
+    static const char no_frame[] = "YUV4MPEG2 W2 H1 F25:1 C444\n";
+    mapped_stream_t stream;
+    check(!write_file(Y4M_PATH, unsupported, sizeof(unsupported) - 1) &&
+          open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == NOT_IMPLEMENTED_ERROR, "y4m: 4:2:2 is rejected");
+    check(!write_file(Y4M_PATH, no_size, sizeof(no_size) - 1) &&
+          open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == RESOLUTION_OBTAINING_ERROR, "y4m: size is required");
+    check(!write_file(Y4M_PATH, no_frame, sizeof(no_frame) - 1) &&
+          open_mapped_stream(&stream, Y4M_PATH, 0, 0, 0) == MAPPING_ERROR, "y4m: a file without frames is rejected");
+}
+
+int main() {
+    check(is_mapped_source("clip.rgb") && is_mapped_source("clip.RAW") && is_mapped_source("clip.y4m"),
+          "raw and y4m files are mapped");
+    check(!is_mapped_source("clip.mp4") && !is_mapped_source(".rgb"), "other files are decoded");
+    test_raw();
+    test_y4m_420();
+    test_y4m_444();
+    test_y4m_mono();
+    test_y4m_rejected();
+    unlink(RGB_PATH);
+    unlink(Y4M_PATH);
+    return n_failed_checks != 0;
+}
@@ -0,0 +1,66 @@
+// Hysteresis of the adaptive quality controller on synthetic frame timings.
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+#include "quality.h"
+#include "timestamps.h"
+
+#define BUDGET_US 40000
+#define SLOW_SOURCE_BUDGET_US 10000  // kept short: every frame really waits twice as long
+#define SLOW_SOURCE_N_FRAMES 30
+
+// feeds n_frames of the same timing; returns how many times the level changed
+static int feed(quality_controller_t *controller, size_t frame_time_us, int n_frames) {
+    int n_changes = 0;
+    for (int i = 0; i < n_frames; ++i)
+        n_changes += update_quality(controller, frame_time_us);
+    return n_changes;
+}
+
+int main() {
+    quality_controller_t controller;
+
+    init_quality_controller(&controller, update_gaussian, OUTPUT_COLORED, BUDGET_US);
+    check(controller.n_steps == 5, "gauss + color: full, naive, mono, 75%, 50%");
+    check(get_quality_step(&controller)->update_kernel == update_gaussian, "starts as configured");
+
+    init_quality_controller(&controller, update_naive, OUTPUT_SIMPLE, BUDGET_US);
+    check(controller.n_steps == 3, "naive + mono: only grid steps are added");
+
+    init_quality_controller(&controller, update_gaussian, OUTPUT_COLORED, BUDGET_US);
+    feed(&controller, BUDGET_US / 4, 200);
+    check(controller.level == 0, "stays at full quality while fast");
+
+    feed(&controller, BUDGET_US * 2, 40);
+    check(controller.level > 0, "steps down under sustained load");
+    check(get_quality_step(&controller)->update_kernel == update_naive, "gauss is dropped first");
+
+    int level = controller.level;
+    check(feed(&controller, BUDGET_US * 7 / 10, 500) == 0, "no flapping between the thresholds");
+    check(controller.level == level, "keeps the level between the thresholds");
+
+    check(feed(&controller, BUDGET_US / 4, 20) == 0, "a short calm period doesn't step up");
+    feed(&controller, BUDGET_US / 4, 1000);
+    check(controller.level == 0, "recovers full quality once calm");
+
+    feed(&controller, BUDGET_US * 10, 1000);
+    check(controller.level == controller.n_steps - 1, "bottoms out at the coarsest step");
+    check(get_quality_step(&controller)->grid_scale < 100, "coarsest step uses a smaller grid");
+
+    // a source slower than the budget (a 25 fps camera) with cheap frames: the main loop times
+    // only the work after the frame data arrived, so waiting for the source mustn't count as load
+    init_quality_controller(&controller, update_gaussian, OUTPUT_COLORED, SLOW_SOURCE_BUDGET_US);
+    work_timer_t frame_work;
+    for (int i = 0; i < SLOW_SOURCE_N_FRAMES; ++i) {
+        reset_work_timer(&frame_work);
+        usleep(SLOW_SOURCE_BUDGET_US * 2);  // blocked on the source
+        start_work_timer(&frame_work);
+        stop_work_timer(&frame_work);
+        update_quality(&controller, frame_work.total_us);
+    }
+    check(frame_work.total_us < SLOW_SOURCE_BUDGET_US, "work timer leaves out the wait");
+    check(controller.level == 0, "a slow source doesn't degrade quality");
+    return n_failed_checks != 0;
+}
@@ -0,0 +1,256 @@
+// Golden output check of the conversion pipeline for every charset, filter and grayscale method,
+// and for every filter and method with edge glyphs. The area filter is rendered to a grid
+// the frame doesn't divide evenly into. A picture with edges on cell boundaries pins down
+// what edge glyphs can't show.
+// Frames are generated in-process, so this test needs neither ffmpeg nor a terminal.
+// Run with --update to rewrite the golden files after an intended output change.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_utils.h"
+#include "status_codes.h"
+
+#define RENDER_WIDTH 320
+#define RENDER_HEIGHT 240
+#define RENDER_ROWS 20
+#define RENDER_COLS 40
+#define RENDER_AREA_ROWS 18  // 13.3 x 7.1 pixel footprints
+#define RENDER_AREA_COLS 45
+#define RENDER_N_FRAMES 3
+#define PATH_BUFFER_SIZE 512
+// naive footprints for a RENDER_ROWS x RENDER_COLS terminal (13 x 9 pixels, as update_grid_size
+// sizes them) and the grid they leave
+#define CELL_PIXEL_ROWS ((RENDER_HEIGHT + RENDER_ROWS) / RENDER_ROWS)
+#define CELL_PIXEL_COLS ((RENDER_WIDTH + RENDER_COLS) / RENDER_COLS)
+#define ALIGNED_N_ROWS (RENDER_HEIGHT / CELL_PIXEL_ROWS)
+#define ALIGNED_N_COLS (RENDER_WIDTH / CELL_PIXEL_COLS)
+#define ALIGNED_EDGE_CHAR_COL 17  // first cell right of the split
+#define ALIGNED_LINE_CHAR_COL 10  // cells the thin lines run through
+#define ALIGNED_LINE_CHAR_ROW 14
+
+typedef void (*fill_frame_method_t)(unsigned char *frame, int width, int height, int frame_index);
+
+// the gradient only compares halves of a footprint, so these are invisible to it: the top half
+// is dark left and bright right of a split on a cell boundary; the bottom half, which also starts
+// on a cell boundary, is bright with one pixel wide dark lines through the middle column and
+// the middle row of cells
+static void fill_grid_aligned_frame(unsigned char *frame, int width, int height, int frame_index) {
+    (void) frame_index;
+    int split_row = ALIGNED_N_ROWS / 2 * CELL_PIXEL_ROWS;
+    int split_col = ALIGNED_EDGE_CHAR_COL * CELL_PIXEL_COLS;
+    int line_col = ALIGNED_LINE_CHAR_COL * CELL_PIXEL_COLS + CELL_PIXEL_COLS / 2;
+    int line_row = ALIGNED_LINE_CHAR_ROW * CELL_PIXEL_ROWS + CELL_PIXEL_ROWS / 2;
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            int dark_flag = (i < split_row) ? j < split_col : (j == line_col || i == line_row);
+            memset(frame + (i * width + j) * 3, dark_flag ? 20 : 230, 3);
+        }
+    }
+}
+
+// the cell in the first frame of a rendered text
+static char get_text_cell(const char *text, int n_cols, int char_row, int char_col) {
+    return text[char_row * (n_cols + 1) + char_col];
+}
+
+// renders RENDER_N_FRAMES test frames; with band_wise set every character row is converted
+// from a band holding only its own pixels, the way --stream does
+static char *render(const user_params_t *user_params, int n_rows, int n_cols, int band_wise,
+                    fill_frame_method_t fill_frame, size_t *text_size) {
+    frame_params_t frame_data;
+    frame_data.width = RENDER_WIDTH;
+    frame_data.height = RENDER_HEIGHT;
+    frame_data.aspect_ratio = frame_data.width / frame_data.height;
+    frame_data.triple_width = frame_data.width * 3;
+    unsigned char *frame = malloc(sizeof(unsigned char) * frame_data.triple_width * frame_data.height);
+    frame_data.video_frame = frame;
+
+    kernel_params_t kernel_data;
+    kernel_data.kernel = NULL;
+    kernel_data.update_kernel = user_params->frame_processing_params.update_kernel;
+    terminal_params_t terminal_params = user_params->terminal_params;
+    update_grid_size(&frame_data, &kernel_data, &terminal_params, n_rows, n_cols);
+
+    cell_cache_t cell_cache;
+    init_cell_cache(&cell_cache);
+    draw_row_method_t draw_row = get_draw_row_method(kernel_data.update_kernel,
+                                                     user_params->frame_processing_params.rgb_channels_processor,
+                                                     OUTPUT_HEADLESS,
+                                                     user_params->frame_processing_params.edge_flag);
+
+    char *text = NULL;
+    FILE *output = open_memstream(&text, text_size);
+    for (int frame_index = 0; frame_index < RENDER_N_FRAMES; ++frame_index) {
+        fill_frame(frame, frame_data.width, frame_data.height, frame_index);
+        if (!band_wise) {
+            draw_frame(&frame_data, &kernel_data, user_params->charset_params,
+                       user_params->frame_processing_params.edge_threshold, 0, draw_row, &cell_cache);
+        } else {
+            fit_cell_cache(&cell_cache, &frame_data, &kernel_data);
+            frame_params_t band_data = frame_data;
+            for (int cur_char_row = 0; cur_char_row < cell_cache.n_rows; ++cur_char_row) {
+                band_data.video_frame = frame + frame_data.triple_width * get_footprint_row(&kernel_data, cur_char_row);
+                draw_row(&band_data, &kernel_data, user_params->charset_params,
+                         user_params->frame_processing_params.edge_threshold, 0, &cell_cache, cur_char_row, 0);
+            }
+        }
+        write_frame_text(&cell_cache, output);
+    }
+    fclose(output);
+
+    free_cell_cache(&cell_cache);
+    free(kernel_data.kernel);
+    free(frame);
+    return text;
+}
+
+static char *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *content = malloc(*size + 1);
+    if (content && fread(content, 1, *size, file) != *size) {
+        free(content);
+        content = NULL;
+    }
+    fclose(file);
+    return content;
+}
+
+// compares text with the golden file, or rewrites the golden file with update_flag set;
+// returns the number of failures
+static int check_golden(const char *golden_path, const char *text, size_t text_size, int update_flag) {
+    int n_failed = 0;
+    size_t golden_size;
+    if (update_flag) {
+        FILE *golden_file = fopen(golden_path, "wb");
+        if (!golden_file || fwrite(text, 1, text_size, golden_file) != text_size) {
+            fprintf(stderr, "FAIL %s: couldn't write golden file\n", golden_path);
+            ++n_failed;
+        }
+        if (golden_file)
+            fclose(golden_file);
+    } else {
+        char *golden = read_file(golden_path, &golden_size);
+        if (!golden) {
+            fprintf(stderr, "FAIL %s: golden file is missing\n", golden_path);
+            ++n_failed;
+        } else if (golden_size != text_size || memcmp(golden, text, text_size)) {
+            fprintf(stderr, "FAIL %s: output differs from golden file\n", golden_path);
+            ++n_failed;
+        }
+        free(golden);
+    }
+    return n_failed;
+}
+
+// the test picture has hard vertical, horizontal and box edges: some of them must come out
+// as edge glyphs the charset itself doesn't have
+static int has_edge_glyphs(const char *text, size_t text_size, const char *char_set) {
+    for (size_t i = 0; i < text_size; ++i)
+        if (strchr("|/-\\", text[i]) && !strchr(char_set, text[i]))
+            return 1;
+    return 0;
+}
+
+// every frame of the text has exactly n_rows lines of n_cols characters
+static int has_grid_size(const char *text, size_t text_size, int n_rows, int n_cols) {
+    size_t frame_size = (size_t) n_rows * (n_cols + 1) + 1;
+    if (!text_size || text_size % frame_size)
+        return 0;
+    for (size_t i = 0; i < text_size; ++i) {
+        size_t frame_offset = i % frame_size;
+        int is_line_end = frame_offset == frame_size - 1 || frame_offset % (n_cols + 1) == (size_t) n_cols;
+        if ((text[i] == '\n') != is_line_end)
+            return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int update_flag = argc > 1 && !strcmp(argv[1], "--update");
+    int n_failed = 0;
+    char golden_path[PATH_BUFFER_SIZE];
+
+    // edge glyphs don't depend on the charset, one is enough for them
+    for (int edge_flag = 0; edge_flag < 2; ++edge_flag) {
+        for (size_t set_ind = 0; set_ind < (edge_flag ? 1 : N_TEST_CHARSETS); ++set_ind) {
+            for (size_t filter_ind = 0; filter_ind < N_TEST_FILTERS; ++filter_ind) {
+                for (size_t method_ind = 0; method_ind < N_TEST_METHODS; ++method_ind) {
+                    user_params_t user_params;
+                    if (parse_test_params(&user_params, test_charsets[set_ind],
+                                          test_filters[filter_ind], test_methods[method_ind], edge_flag)) {
+                        fprintf(stderr, "argparse rejected test parameters!\n");
+                        return FLAG_ERROR;
+                    }
+                    snprintf(golden_path, PATH_BUFFER_SIZE, "%s/%s_%s_%s%s.txt", PIX2ASCII_GOLDEN_DIR,
+                             test_charsets[set_ind], test_filters[filter_ind], test_methods[method_ind],
+                             edge_flag ? "_edges" : "");
+
+                    int area_flag = user_params.frame_processing_params.update_kernel == update_area;
+                    int n_rows = area_flag ? RENDER_AREA_ROWS : RENDER_ROWS;
+                    int n_cols = area_flag ? RENDER_AREA_COLS : RENDER_COLS;
+                    size_t text_size, band_text_size;
+                    char *text = render(&user_params, n_rows, n_cols, 0, fill_test_frame, &text_size);
+                    char *band_text = render(&user_params, n_rows, n_cols, 1, fill_test_frame, &band_text_size);
+                    if (band_text_size != text_size || memcmp(text, band_text, text_size)) {
+                        fprintf(stderr, "FAIL %s: band-wise output differs from whole-frame output\n", golden_path);
+                        ++n_failed;
+                    }
+                    if (area_flag && !has_grid_size(text, text_size, n_rows, n_cols)) {
+                        fprintf(stderr, "FAIL %s: grid isn't exactly %dx%d\n", golden_path, n_rows, n_cols);
+                        ++n_failed;
+                    }
+                    if (edge_flag && !has_edge_glyphs(text, text_size, user_params.charset_params.char_set)) {
+                        fprintf(stderr, "FAIL %s: no edge glyphs\n", golden_path);
+                        ++n_failed;
+                    }
+                    n_failed += check_golden(golden_path, text, text_size, update_flag);
+                    free(text);
+                    free(band_text);
+                }
+            }
+        }
+    }
+
+    // edges on cell boundaries and lines through the middle of a cell get brightness glyphs
+    // instead of edge glyphs: the split still shows as a step, the lines as they would
+    // without --edges
+    user_params_t user_params;
+    if (parse_test_params(&user_params, "sharp", "naive", "average", 1)) {
+        fprintf(stderr, "argparse rejected test parameters!\n");
+        return FLAG_ERROR;
+    }
+    snprintf(golden_path, PATH_BUFFER_SIZE, "%s/grid_aligned_naive_average_edges.txt", PIX2ASCII_GOLDEN_DIR);
+    size_t text_size;
+    char *text = render(&user_params, RENDER_ROWS, RENDER_COLS, 0, fill_grid_aligned_frame, &text_size);
+    user_params.frame_processing_params.edge_flag = 0;
+    size_t plain_text_size;
+    char *plain_text = render(&user_params, RENDER_ROWS, RENDER_COLS, 0, fill_grid_aligned_frame, &plain_text_size);
+    if (!has_grid_size(text, text_size, ALIGNED_N_ROWS, ALIGNED_N_COLS) ||
+        get_text_cell(text, ALIGNED_N_COLS, 0, ALIGNED_EDGE_CHAR_COL - 1) ==
+        get_text_cell(text, ALIGNED_N_COLS, 0, ALIGNED_EDGE_CHAR_COL)) {
+        fprintf(stderr, "FAIL %s: the split on a cell boundary isn't visible\n", golden_path);
+        ++n_failed;
+    }
+    if (plain_text_size != text_size || memcmp(plain_text, text, text_size)) {
+        fprintf(stderr, "FAIL %s: edges the gradient can't see don't fall back to brightness glyphs\n",
+                golden_path);
+        ++n_failed;
+    }
+    free(plain_text);
+    n_failed += check_golden(golden_path, text, text_size, update_flag);
+    free(text);
+
+    if (get_resample_axis(RENDER_WIDTH, RENDER_AREA_COLS) != get_resample_axis(RENDER_WIDTH, RENDER_AREA_COLS)) {
+        fprintf(stderr, "FAIL: resample tables are rebuilt for the same sizes\n");
+        ++n_failed;
+    }
+    free_resample_cache();
+    return n_failed != 0;
+}
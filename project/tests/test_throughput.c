@@ -0,0 +1,179 @@
+// Frames-per-second floor of the conversion pipeline on 1280x720 frames.
+// Rates are measured relative to a plain pass over the same frames on the same machine and build,
+// so a slow machine or a debug build scales both sides; these relative rates are compared with
+// the ones recorded in perf_baseline.txt, and a scenario fails below PERF_FLOOR_RATIO of its baseline.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test_utils.h"
+#include "status_codes.h"
+
+#define PERF_WIDTH 1280
+#define PERF_HEIGHT 720
+#define PERF_ROWS 45
+#define PERF_COLS 160
+#define PERF_N_FRAMES 60
+#define PERF_FLOOR_RATIO 0.5
+#define PERF_REFERENCE_N_PASSES 40
+#define PERF_REFERENCE_N_RUNS 3  // the fastest run counts, so a busy moment doesn't raise every score
+#define PERF_KEY_SIZE 64
+
+typedef struct {
+    const char *name;
+    const char *filter;
+    int static_scene;  // same picture every frame: exercises the cell cache
+    int edge_flag;
+} perf_scenario_t;
+
+static const perf_scenario_t scenarios[] = {
+        {"convert_720p_naive_fps", "naive", 0, 0},
+        {"convert_720p_gauss_fps", "gauss", 0, 0},
+        {"convert_720p_static_fps", "naive", 1, 0},
+        {"convert_720p_edges_fps", "naive", 0, 1},
+        {"convert_720p_area_fps", "area", 0, 0},
+};
+
+static double measure_fps(const perf_scenario_t *scenario) {
+    user_params_t user_params;
+    if (parse_test_params(&user_params, "long", scenario->filter, "yuv", scenario->edge_flag))
+        return -1;
+
+    frame_params_t frame_data;
+    frame_data.width = PERF_WIDTH;
+    frame_data.height = PERF_HEIGHT;
+    frame_data.aspect_ratio = frame_data.width / frame_data.height;
+    frame_data.triple_width = frame_data.width * 3;
+
+    // two pictures differing in every pixel, so a changing scene never hits the cache
+    size_t frame_size = (size_t) frame_data.triple_width * frame_data.height;
+    unsigned char *frames[2] = {malloc(frame_size), malloc(frame_size)};
+    if (!frames[0] || !frames[1])
+        return -1;
+    fill_test_frame(frames[0], frame_data.width, frame_data.height, 0);
+    for (size_t i = 0; i < frame_size; ++i)
+        frames[1][i] = frames[0][i] ^ 0x55;
+
+    kernel_params_t kernel_data;
+    kernel_data.kernel = NULL;
+    kernel_data.update_kernel = user_params.frame_processing_params.update_kernel;
+    frame_data.video_frame = frames[0];
+    update_grid_size(&frame_data, &kernel_data, &user_params.terminal_params, PERF_ROWS, PERF_COLS);
+
+    cell_cache_t cell_cache;
+    init_cell_cache(&cell_cache);
+    draw_row_method_t draw_row = get_draw_row_method(kernel_data.update_kernel,
+                                                     user_params.frame_processing_params.rgb_channels_processor,
+                                                     OUTPUT_HEADLESS,
+                                                     user_params.frame_processing_params.edge_flag);
+    FILE *null_output = fopen("/dev/null", "w");
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int frame_index = 0; frame_index < PERF_N_FRAMES; ++frame_index) {
+        frame_data.video_frame = frames[scenario->static_scene ? 0 : frame_index % 2];
+        draw_frame(&frame_data, &kernel_data, user_params.charset_params,
+                   user_params.frame_processing_params.edge_threshold, 0, draw_row, &cell_cache);
+        write_frame_text(&cell_cache, null_output);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fclose(null_output);
+    free_cell_cache(&cell_cache);
+    free(kernel_data.kernel);
+    free(frames[0]);
+    free(frames[1]);
+    double elapsed = (double) (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    return PERF_N_FRAMES / elapsed;
+}
+
+// passes per second of an FNV-1a hash over alternating frames: as much memory as a conversion
+// and a fixed amount of work per byte; the multiply chain can't be vectorized, so compiler
+// flags change its speed about as much as they change the pipeline's
+static double measure_reference_rate(void) {
+    size_t frame_size = (size_t) PERF_WIDTH * 3 * PERF_HEIGHT;
+    unsigned char *frames[2] = {malloc(frame_size), malloc(frame_size)};
+    if (!frames[0] || !frames[1]) {
+        free(frames[0]);
+        free(frames[1]);
+        return -1;
+    }
+    fill_test_frame(frames[0], PERF_WIDTH, PERF_HEIGHT, 0);
+    for (size_t i = 0; i < frame_size; ++i)
+        frames[1][i] = frames[0][i] ^ 0x55;
+
+    double best_rate = 0;
+    volatile unsigned int sink = 0;  // keeps the hashes from being optimized away
+    for (int run = 0; run < PERF_REFERENCE_N_RUNS; ++run) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int pass = 0; pass < PERF_REFERENCE_N_PASSES; ++pass) {
+            const unsigned char *frame = frames[pass % 2];
+            unsigned int hash = 2166136261u;
+            for (size_t i = 0; i < frame_size; ++i)
+                hash = (hash ^ frame[i]) * 16777619u;
+            sink += hash;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (double) (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (PERF_REFERENCE_N_PASSES / elapsed > best_rate)
+            best_rate = PERF_REFERENCE_N_PASSES / elapsed;
+    }
+    free(frames[0]);
+    free(frames[1]);
+    return best_rate;
+}
+
+static double read_baseline(const char *name) {
+    FILE *baseline_file = fopen(PIX2ASCII_PERF_BASELINE, "r");
+    if (!baseline_file)
+        return -1;
+
+    char key[PERF_KEY_SIZE];
+    double value, baseline = -1;
+    int n_matched;
+    while ((n_matched = fscanf(baseline_file, "%63s %lf", key, &value)) != EOF) {
+        if (n_matched == 2 && !strcmp(key, name)) {
+            baseline = value;
+            break;
+        } else if (n_matched != 2) {  // comment line
+            fscanf(baseline_file, "%*[^\n]");
+        }
+    }
+    fclose(baseline_file);
+    return baseline;
+}
+
+int main(int argc, char *argv[]) {
+    int n_failed = 0;
+    double reference_rate = measure_reference_rate();
+    if (reference_rate <= 0) {
+        fprintf(stderr, "FAIL: couldn't run the reference pass\n");
+        return 1;
+    }
+    printf("reference %.1f passes/s\n", reference_rate);
+    if (argc > 1 && !strcmp(argv[1], "--reference"))  // e2e.sh scales its own fps by the same pass
+        return 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(*scenarios); ++i) {
+        double fps = measure_fps(&scenarios[i]);
+        double relative_fps = fps / reference_rate;
+        double baseline = read_baseline(scenarios[i].name);
+        if (fps < 0) {
+            fprintf(stderr, "FAIL %s: couldn't run scenario\n", scenarios[i].name);
+            ++n_failed;
+        } else if (baseline < 0) {
+            fprintf(stderr, "FAIL %s: no baseline in %s (measured %.3f)\n",
+                    scenarios[i].name, PIX2ASCII_PERF_BASELINE, relative_fps);
+            ++n_failed;
+        } else if (relative_fps < baseline * PERF_FLOOR_RATIO) {
+            fprintf(stderr, "FAIL %s: %.3f (%.1f fps), floor is %.3f (baseline %.3f)\n",
+                    scenarios[i].name, relative_fps, fps, baseline * PERF_FLOOR_RATIO, baseline);
+            ++n_failed;
+        } else {
+            printf("%s %.3f (%.1f fps, baseline %.3f)\n", scenarios[i].name, relative_fps, fps, baseline);
+        }
+    }
+    return n_failed != 0;
+}
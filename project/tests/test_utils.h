@@ -0,0 +1,70 @@
+#ifndef PIX2ASCII_TESTS_TEST_UTILS_H
+#define PIX2ASCII_TESTS_TEST_UTILS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "argparsing.h"
+#include "frame_processing.h"
+#include "termstream.h"
+
+#define SKIP_RETURN_CODE 77  // registered as SKIP_RETURN_CODE for ctest
+
+// not every test goes through all combinations
+static __attribute__((unused)) const char *test_charsets[] = {"sharp", "optimal", "standard", "long"};
+static __attribute__((unused)) const char *test_filters[] = {"naive", "gauss", "area"};
+static __attribute__((unused)) const char *test_methods[] = {"average", "yuv"};
+
+#define N_TEST_CHARSETS (sizeof(test_charsets) / sizeof(*test_charsets))
+#define N_TEST_FILTERS (sizeof(test_filters) / sizeof(*test_filters))
+#define N_TEST_METHODS (sizeof(test_methods) / sizeof(*test_methods))
+
+static int n_failed_checks = 0;
+
+// reports a failed condition and counts it; tests return n_failed_checks != 0
+static inline void check(int condition, const char *message) {
+    if (!condition) {
+        fprintf(stderr, "FAIL %s\n", message);
+        ++n_failed_checks;
+    }
+}
+
+// configures user_params exactly like the command line would
+static inline int parse_test_params(user_params_t *user_params, const char *charset, const char *filter, const char *method,
+                                    int edge_flag) {
+    char *argv[] = {"pix2ascii", "-f", "synthetic",
+                    "-set", (char *) charset, "-filter", (char *) filter, "-method", (char *) method, "--edges"};
+    return argparse(user_params, sizeof(argv) / sizeof(*argv) - !edge_flag, argv);
+}
+
+// deterministic test picture: color bars on top, a gradient below and a box moving with frame_index
+static inline void fill_test_frame(unsigned char *frame, int width, int height, int frame_index) {
+    static const unsigned char bars[8][3] = {
+            {255, 255, 255}, {255, 255, 0}, {0, 255, 255}, {0, 255, 0},
+            {255, 0, 255}, {255, 0, 0}, {0, 0, 255}, {0, 0, 0}
+    };
+    int box_size = height / 5;
+    int box_row = height / 2 + (frame_index * 5) % (height / 2 - box_size);
+    int box_col = (frame_index * 11) % (width - box_size);
+    for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+            unsigned char *pixel = frame + (i * width + j) * 3;
+            if (i >= box_row && i < box_row + box_size && j >= box_col && j < box_col + box_size) {
+                pixel[0] = 230;
+                pixel[1] = 40;
+                pixel[2] = (unsigned char) (frame_index * 20);
+            } else if (i < height / 2) {
+                const unsigned char *bar = bars[j * 8 / width];
+                pixel[0] = bar[0];
+                pixel[1] = bar[1];
+                pixel[2] = bar[2];
+            } else {
+                pixel[0] = (unsigned char) (j * 255 / width);
+                pixel[1] = (unsigned char) ((i - height / 2) * 255 / (height - height / 2));
+                pixel[2] = (unsigned char) (255 - j * 255 / width);
+            }
+        }
+    }
+}
+
+#endif  // PIX2ASCII_TESTS_TEST_UTILS_H